@@ -0,0 +1,112 @@
+//
+//  JSONCodec.cpp
+//  network benchmarks
+//
+//  Created by Valentin Dufois on 2020-04-10.
+//
+//  Compares the JSON codec used by the `json` and `ndjson` socket formats with
+//  the protobuf utilities it replaces, and checks that both print the same bytes.
+//
+//  Not part of the library target. From the repository root, generate the
+//  messages with `protoc -I network/Messages --cpp_out=network/Messages
+//  network/Messages/network.proto`, then build with:
+//
+//    c++ -std=gnu++14 -O2 -I. benchmarks/JSONCodec.cpp network/Socket/JSONCodec.cpp network/Messages/MessageRegistry.cpp network/Messages/network.pb.cc -lprotobuf -o json-benchmark
+//
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/util/json_util.h>
+
+#include "../network/Messages/MessageRegistry.hpp"
+#include "../network/Socket/JSONCodec.hpp"
+
+using namespace network;
+
+/// Runs the given function the given number of times
+/// @return The average duration of a run, in nanoseconds
+static double measure(const std::size_t &iterations, const std::function<void()> &run) {
+	const auto start = std::chrono::steady_clock::now();
+
+	for(std::size_t i = 0; i < iterations; ++i)
+		run();
+
+	const auto duration = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+}
+
+static bool compare(const char * name, const protobuf::Message &message, const std::size_t &iterations) {
+	std::string reference;
+	protobuf::util::MessageToJsonString(message, &reference);
+
+	std::string output;
+	JSONCodec::instance()->encode(message, output);
+
+	if(output != reference) {
+		std::printf("%s: output differs\n  protobuf: %s\n  codec:    %s\n", name, reference.c_str(), output.c_str());
+		return false;
+	}
+
+	std::unique_ptr<protobuf::Message> parsed(message.New());
+
+	// Encoding
+	const double protobufEncode = measure(iterations, [&] {
+		std::string text;
+		protobuf::util::MessageToJsonString(message, &text);
+	});
+
+	const double codecEncode = measure(iterations, [&] {
+		// The output buffer is reused, like the socket sending buffers
+		output.clear();
+		JSONCodec::instance()->encode(message, output);
+	});
+
+	// Decoding
+	const double protobufDecode = measure(iterations, [&] {
+		protobuf::util::JsonStringToMessage(reference, parsed.get());
+	});
+
+	const double codecDecode = measure(iterations, [&] {
+		JSONCodec::instance()->decode(reference.data(), reference.size(), parsed.get());
+	});
+
+	std::printf("%-10s %5zu bytes   encode %8.0f ns -> %7.0f ns (x%.1f)   decode %8.0f ns -> %7.0f ns (x%.1f)\n",
+				name, reference.size(),
+				protobufEncode, codecEncode, protobufEncode / codecEncode,
+				protobufDecode, codecDecode, protobufDecode / codecDecode);
+
+	return true;
+}
+
+int main() {
+	const std::size_t iterations = 200000;
+
+	messages::Endpoint endpoint;
+	endpoint.set_name("living-room-display");
+	endpoint.set_type("_pipe._tcp");
+
+	messages::Ping ping;
+	ping.set_time(1586534400123);
+
+	messages::Datagram datagram;
+	datagram.set_type(5);
+	MessageRegistry::instance()->pack(ping, datagram);
+
+	messages::Datagram large;
+	large.set_type(42);
+	large.set_payload_type(2);
+	large.set_payload(std::string(4096, '\x5A'));
+
+	bool identical = true;
+
+	identical &= compare("Endpoint", endpoint, iterations);
+	identical &= compare("Ping", ping, iterations);
+	identical &= compare("Datagram", datagram, iterations);
+	identical &= compare("Large", large, iterations / 20);
+
+	return identical ? 0 : 1;
+}
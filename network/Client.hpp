@@ -0,0 +1,16 @@
+//
+//  Client.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef Client_h
+#define Client_h
+
+#include "Client/BaseClient.hpp"
+#include "Client/Client.hpp"
+#include "Client/ClientDelegate.hpp"
+
+#endif /* Client_h */
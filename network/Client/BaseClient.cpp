@@ -0,0 +1,297 @@
+//
+//  BaseClient.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include <common/log.hpp>
+
+#include "BaseClient.hpp"
+
+#include "../Socket/BaseSocket.hpp"
+
+namespace network {
+
+BaseClient::BaseClient(const Endpoint &remote): _remote(remote) {}
+
+void BaseClient::open() {
+	ClientState state = ClientState::idle;
+
+	if(!_state.compare_exchange_strong(state, ClientState::connecting))
+		return;
+
+	_attempts = 0;
+
+	connect();
+}
+
+void BaseClient::close() {
+	BaseSocket * socket = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if(_state == ClientState::idle)
+			return;
+
+		_state = ClientState::idle;
+
+		Engine::instance()->getTimerWheel().cancel(_reconnectTimer);
+		_replayMessages.clear();
+
+		socket = _socket;
+	}
+
+	// Messages still queued by the socket are released once it closes
+	if(socket)
+		socket->close();
+
+	if(delegate)
+		delegate->clientDidChangeState(this, ClientState::idle);
+}
+
+BaseClient::~BaseClient() {
+	close();
+
+	// The aborted operations of the socket must not reach the client
+	if(_socket) {
+		_socket->delegate = nullptr;
+		BaseSocket::release(_socket);
+	}
+}
+
+void BaseClient::release(BaseClient * client) {
+	if(client == nullptr)
+		return;
+
+	// A reconnection starting from now on finds the client closed
+	client->close();
+
+	// A reconnection already running is done before the client is deleted
+	asio::post(Engine::instance()->getContext(), [client] {
+		delete client;
+	});
+
+	Engine::instance()->runContext();
+}
+
+// MARK: - Exchanges
+
+void BaseClient::send(std::shared_ptr<const protobuf::Message> message, const Lane &lane) {
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	if(_state != ClientState::connected) {
+		_replayMessages.push_back({std::move(message), lane});
+		trimReplay();
+		return;
+	}
+
+	// The message is kept until the socket is done with it
+	const protobuf::Message * raw = message.get();
+	_pendingMessages.push_back({std::move(message), lane});
+
+	BaseSocket * socket = _socket;
+	lock.unlock();
+
+	socket->send(raw, lane);
+
+	// Synchronous sockets are done with the message once it returns
+	if(socket->getEmissionType() == EmissionType::sync) {
+		lock.lock();
+		releasePending(raw);
+	}
+}
+
+std::size_t BaseClient::getReplayCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _replayMessages.size();
+}
+
+// MARK: - Internal
+
+void BaseClient::connect() {
+	BaseSocket * previous = nullptr;
+	BaseSocket * socket = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if(_state == ClientState::idle)
+			return;
+
+		_state = ClientState::connecting;
+
+		previous = _socket;
+
+		socket = _socket = makeSocket();
+		socket->delegate = this;
+	}
+
+	// The previous socket is closed, its aborted operations are done with the client
+	if(previous) {
+		previous->delegate = nullptr;
+		BaseSocket::release(previous);
+	}
+
+	if(delegate)
+		delegate->clientDidChangeState(this, ClientState::connecting);
+
+	LOG_DEBUG("Client connecting to " + _remote.uri() + " (attempt " + std::to_string(_attempts + 1) + ")");
+	socket->asyncConnectTo(_remote);
+}
+
+void BaseClient::scheduleReconnect() {
+	{
+		// A concurrent close must not see the timer before it is armed
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if(_state == ClientState::idle)
+			return;
+
+		// Exponential backoff, with a random part taken off
+		const double backoff = std::min<double>(_reconnectMaxDelay, _reconnectDelay * std::pow(2.0, std::min(_attempts, 20u)));
+		std::uniform_real_distribution<double> jitter(1.0 - _reconnectJitter, 1.0);
+		const long delay = (long)(backoff * jitter(_random));
+
+		++_attempts;
+
+		_state = ClientState::waiting;
+
+		Engine::instance()->getTimerWheel().cancel(_reconnectTimer);
+		_reconnectTimer = Engine::instance()->getTimerWheel().schedule((unsigned int)delay, [&] {
+			connect();
+		});
+	}
+
+	if(delegate)
+		delegate->clientDidChangeState(this, ClientState::waiting);
+}
+
+void BaseClient::socketDidOpen(BaseSocket * socket) {
+	std::size_t replayCount = 0;
+	std::deque<ClientMessage> replay;
+
+	// Waiting messages are sent first. Messages given meanwhile keep waiting
+	// behind them, until none are left
+	while(true) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if(_state == ClientState::idle || socket->getStatus() != SocketStatus::ready)
+				return;
+
+			if(_replayMessages.empty()) {
+				_state = ClientState::connected;
+				break;
+			}
+
+			replay.swap(_replayMessages);
+			_pendingMessages.insert(_pendingMessages.end(), replay.begin(), replay.end());
+		}
+
+		for(const ClientMessage &queued: replay) {
+			// The connection may be lost again, the messages are back waiting
+			if(socket->getStatus() != SocketStatus::ready)
+				break;
+
+			socket->send(queued.message.get(), queued.lane);
+
+			if(socket->getEmissionType() == EmissionType::sync) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				releasePending(queued.message.get());
+			}
+		}
+
+		replayCount += replay.size();
+		replay.clear();
+	}
+
+	if(_hasConnected)
+		++_reconnectCount;
+
+	_hasConnected = true;
+	_attempts = 0;
+
+	LOG_INFO("Client connected to " + _remote.uri() + ", replayed " + std::to_string(replayCount) + " messages");
+
+	if(delegate)
+		delegate->clientDidChangeState(this, ClientState::connected);
+}
+
+void BaseClient::socketDidFailToConnect(BaseSocket *) {
+	LOG_WARN("Client could not connect to " + _remote.uri());
+
+	scheduleReconnect();
+}
+
+void BaseClient::socketDidReceive(BaseSocket *, const protobuf::Message * message) {
+	if(delegate)
+		return delegate->clientDidReceive(this, message);
+
+	delete message;
+}
+
+void BaseClient::socketDidSendAsynchronously(BaseSocket *, const protobuf::Message * message) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	releasePending(message);
+}
+
+void BaseClient::socketDidDropMessage(BaseSocket * socket, const protobuf::Message * message) {
+	// Messages dropped by the socket on close are replayed once reconnected
+	if(socket->getStatus() != SocketStatus::ready)
+		return;
+
+	// Messages dropped by the overflow policy, or by conflation, are gone
+	std::lock_guard<std::mutex> lock(_mutex);
+	releasePending(message);
+}
+
+void BaseClient::socketDidClose(BaseSocket *) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// Messages the socket did not send go first once reconnected
+		if(_state != ClientState::idle) {
+			_replayMessages.insert(_replayMessages.begin(), std::make_move_iterator(_pendingMessages.begin()), std::make_move_iterator(_pendingMessages.end()));
+			trimReplay();
+		}
+
+		_pendingMessages.clear();
+	}
+
+	if(_state == ClientState::idle)
+		return;
+
+	LOG_WARN("Client lost its connection to " + _remote.uri());
+
+	scheduleReconnect();
+}
+
+bool BaseClient::releasePending(const protobuf::Message * message) {
+	auto it = std::find_if(_pendingMessages.begin(), _pendingMessages.end(), [&] (const ClientMessage &pending) {
+		return pending.message.get() == message;
+	});
+
+	if(it == _pendingMessages.end())
+		return false;
+
+	_pendingMessages.erase(it);
+	return true;
+}
+
+void BaseClient::trimReplay() {
+	if(_replayMaxCount == 0 || _replayMessages.size() <= _replayMaxCount)
+		return;
+
+	const std::size_t dropped = _replayMessages.size() - _replayMaxCount;
+
+	_replayMessages.erase(_replayMessages.begin(), _replayMessages.begin() + dropped);
+	_droppedCount += dropped;
+}
+
+} /* ::network */
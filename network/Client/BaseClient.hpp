@@ -0,0 +1,235 @@
+//
+//  BaseClient.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef BaseClient_hpp
+#define BaseClient_hpp
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <type_traits>
+
+#include <boost/asio.hpp>
+
+#include <google/protobuf/message.h>
+
+#include "ClientDelegate.hpp"
+
+#include "../Socket/SocketStatus.hpp"
+#include "../Socket/SocketDelegate.hpp"
+#include "../Endpoint.hpp"
+#include "../Engine.hpp"
+
+namespace asio = boost::asio;
+namespace protobuf = google::protobuf;
+
+namespace network {
+
+// Forward Declaration
+class BaseSocket;
+
+/// A Client keeps a connection open with a remote, reconnecting automatically
+/// every time the connection is lost.
+///
+/// Reconnection attempts are spaced with an exponential backoff, with a random
+/// part to spread clients reconnecting at the same time. Messages sent while
+/// the client is not connected, and messages still queued by the socket when
+/// the connection is lost, are kept and sent again once reconnected.
+///
+/// A new socket is used for every connection. The client class is abstract and
+/// made to be subclassed, see `Client`.
+///
+/// Reconnections run on the network thread. A client waiting to reconnect
+/// must be released with `release`, or deleted on the network thread outside
+/// of its own callbacks.
+class BaseClient: public SocketDelegate {
+public:
+
+	// MARK: - Lifecycle
+
+	/// Creates a client for the given remote. The client does not connect until opened.
+	/// @param remote The endpoint to connect to
+	BaseClient(const Endpoint &remote);
+
+	/// Connects to the remote. The client reconnects until it is closed.
+	void open();
+
+	/// Closes the connection, and stops reconnecting. Messages waiting to be
+	/// sent are released.
+	void close();
+
+	virtual ~BaseClient();
+
+	/// Closes the given client, and deletes it once a reconnection already
+	/// running is done. Clients are released this way from any other thread
+	/// than the network one.
+	/// @param client The client to release
+	static void release(BaseClient * client);
+
+	// MARK: - Exchanges
+
+	/// Sends the given message to the remote, taking ownership of it.
+	///
+	/// If the client is not connected, the message is kept until it is. The
+	/// message is released once sent.
+	/// @param message The message to send
+	/// @param lane The priority lane of the message
+	void send(std::shared_ptr<const protobuf::Message> message, const Lane &lane = normalLane);
+
+	/// Sends the given message to the remote. The message is moved, or copied,
+	/// in a message owned by the client.
+	/// @param message The message to send
+	/// @param lane The priority lane of the message
+	template<class MessageType, typename = typename std::enable_if<std::is_base_of<protobuf::Message, typename std::decay<MessageType>::type>::value>::type>
+	inline void send(MessageType &&message, const Lane &lane = normalLane) {
+		using Type = typename std::decay<MessageType>::type;
+		send(std::shared_ptr<const protobuf::Message>(new Type(std::forward<MessageType>(message))), lane);
+	}
+
+	// MARK: - Properties
+
+	ClientDelegate * delegate = nullptr;
+
+	/// Gives the state of the client
+	inline ClientState getState() const { return _state; }
+
+	/// Gives the socket of the current connection, if any. The socket is
+	/// replaced on every reconnection.
+	inline BaseSocket * getSocket() const { return _socket; }
+
+	/// Gives the remote endpoint of the client
+	inline Endpoint getRemote() const { return _remote; }
+
+	inline SocketFormat getEmissionFormat() { return _emissionFormat; }
+
+	/// Sets the exchange format of the client. Only applies to connections
+	/// made afterward.
+	/// @param aFormat An exchange format
+	inline void setEmissionFormat(const SocketFormat &aFormat) {
+		_emissionFormat = aFormat;
+	}
+
+	/// Sets the delays between reconnection attempts. The delay doubles after
+	/// every failed attempt, up to its maximum.
+	/// @param delay Delay in milliseconds before the first attempt
+	/// @param maxDelay Maximum delay in milliseconds
+	/// @param jitter Part of the delay randomly taken off, between 0 and 1
+	inline void setReconnectDelays(const unsigned int &delay, const unsigned int &maxDelay, const float &jitter = reconnectJitter) {
+		_reconnectDelay = delay;
+		_reconnectMaxDelay = maxDelay;
+		_reconnectJitter = jitter;
+	}
+
+	/// Sets the maximum number of messages kept while the client is not
+	/// connected. Once full, the oldest messages are dropped.
+	/// @param maxCount A number of messages
+	inline void setReplayLimit(const std::size_t &maxCount) { _replayMaxCount = maxCount; }
+
+	/// Gives the number of messages waiting for the client to reconnect
+	std::size_t getReplayCount();
+
+	/// Gives the number of messages dropped because too many were waiting for
+	/// the client to reconnect
+	inline std::size_t getDroppedCount() const { return _droppedCount; }
+
+	/// Gives the number of connections made after the first one
+	inline std::size_t getReconnectCount() const { return _reconnectCount; }
+
+protected:
+
+	// MARK: - Internal
+
+	virtual BaseSocket * makeSocket() = 0;
+
+	virtual void socketDidOpen(BaseSocket * socket) override;
+
+	virtual void socketDidFailToConnect(BaseSocket * socket) override;
+
+	virtual void socketDidReceive(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidSendAsynchronously(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidDropMessage(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidClose(BaseSocket * socket) override;
+
+private:
+
+	/// The endpoint the client connects to
+	Endpoint _remote;
+
+	std::atomic<ClientState> _state = {ClientState::idle};
+
+	/// The socket of the current connection. Previous sockets are released
+	/// when the next connection is attempted.
+	BaseSocket * _socket = nullptr;
+
+	SocketFormat _emissionFormat = SocketFormat::protobuf;
+
+	/// Protects the socket and the messages
+	std::mutex _mutex;
+
+	// MARK: Reconnection
+
+	unsigned int _reconnectDelay = reconnectDelay;
+
+	unsigned int _reconnectMaxDelay = reconnectMaxDelay;
+
+	float _reconnectJitter = reconnectJitter;
+
+	/// Number of failed attempts since the last connection
+	unsigned int _attempts = 0;
+
+	/// Set once the client connected a first time
+	bool _hasConnected = false;
+
+	std::atomic<std::size_t> _reconnectCount = {0};
+
+	TimerWheel::TimerID _reconnectTimer = 0;
+
+	std::minstd_rand _random = std::minstd_rand(std::random_device()());
+
+	/// Connects a new socket to the remote
+	void connect();
+
+	/// Waits for the backoff delay before connecting again
+	void scheduleReconnect();
+
+	// MARK: Replay
+
+	/// A message sent through the client
+	struct ClientMessage {
+		std::shared_ptr<const protobuf::Message> message;
+
+		Lane lane = normalLane;
+	};
+
+	/// Messages given to the current socket, not sent yet
+	std::deque<ClientMessage> _pendingMessages;
+
+	/// Messages waiting for the client to reconnect
+	std::deque<ClientMessage> _replayMessages;
+
+	std::size_t _replayMaxCount = replayMaxCount;
+
+	std::atomic<std::size_t> _droppedCount = {0};
+
+	/// Releases the first pending message matching the given one
+	/// @return False if the message was not sent through the client
+	bool releasePending(const protobuf::Message * message);
+
+	/// Drops the oldest messages waiting for the client to reconnect, until
+	/// their number is within the limit
+	void trimReplay();
+};
+
+} /* ::network */
+
+#endif /* BaseClient_hpp */
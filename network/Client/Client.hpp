@@ -0,0 +1,44 @@
+//
+//  Client.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef Client_hpp
+#define Client_hpp
+
+#include "BaseClient.hpp"
+#include "../Socket/Socket.hpp"
+
+namespace network {
+
+/// A Client keeps a connection open with a remote, reconnecting automatically
+/// every time the connection is lost. See `BaseClient`.
+template<class MessageFormat = messages::Datagram>
+class Client: public BaseClient {
+public:
+
+	// MARK: - Lifecycle
+
+	/// Creates a client for the given remote
+	/// @param remote The endpoint to connect to
+	Client(const Endpoint &remote): BaseClient(remote) {}
+
+	/// Creates a client for the given ip and port
+	Client(const std::string &ip, const NetworkPort &port): BaseClient(Endpoint(ip, port)) {}
+
+protected:
+
+	inline BaseSocket * makeSocket() override {
+		Socket<MessageFormat> * newSocket = new Socket<MessageFormat>();
+		newSocket->setFormat(getEmissionFormat());
+
+		return newSocket;
+	}
+};
+
+} /* ::network */
+
+#endif /* Client_hpp */
@@ -0,0 +1,55 @@
+//
+//  ClientDelegate.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef ClientDelegate_h
+#define ClientDelegate_h
+
+// MARK: Forward declarations
+
+namespace google {
+namespace protobuf {
+class Message;
+}
+}
+
+namespace network {
+class BaseClient;
+}
+
+// MARK: - ClientDelegate
+
+namespace network {
+
+/// Defines the states a `Client` goes through
+enum class ClientState {
+	/// The client is not opened, or was closed
+	idle,
+	/// The client is connecting to its remote
+	connecting,
+	/// The client is connected, messages are sent right away
+	connected,
+	/// The connection was lost or could not be made, the client waits before
+	/// trying again. Messages are kept until it reconnects
+	waiting
+};
+
+class ClientDelegate {
+public:
+	/// Called everytime the state of the client changes
+	virtual void clientDidChangeState(BaseClient *, const ClientState &) {}
+
+	/// Called everytime the client received a message from its remote.
+	///
+	/// The delegate takes ownership of the message, and is responsible
+	/// for freeing it.
+	virtual void clientDidReceive(BaseClient *, const google::protobuf::Message *) {}
+};
+
+} /* ::network */
+
+#endif /* ClientDelegate_h */
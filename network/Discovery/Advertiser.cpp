@@ -6,7 +6,6 @@
 //  Copyright © 2019 Prisme. All rights reserved.
 //
 
-#include <boost/bind.hpp>
 #include <iostream>
 #include <string>
 
@@ -61,7 +60,7 @@ void Advertiser::startAdvertising() {
 	_isRunning = true;
 }
 
-void Advertiser::advertise(const boost::system::error_code &e) {
+void Advertiser::advertise() {
 	if(!_isRunning)
 		return;
 
@@ -83,10 +82,8 @@ void Advertiser::stopAdvertising() {
 	if(!_isRunning)
 		return;
 
-	// Stop and erase timer
-	_timer->cancel();
-	delete _timer;
-	_timer = nullptr;
+	// Stop the timer
+	Engine::instance()->getTimerWheel().cancel(_timer);
 
 	// Close the socket
 	_socket->close();
@@ -97,15 +94,9 @@ void Advertiser::stopAdvertising() {
 }
 
 void Advertiser::setTimer() {
-	if(!_isRunning) {
-		// Create the timer
-		_timer = new asio::deadline_timer(Engine::instance()->getContext());
-	}
-
-	// Set up the timer
-	_timer->expires_from_now(boost::posix_time::seconds(advertiserRate));
-	_timer->async_wait(boost::bind(&Advertiser::advertise, this, boost::asio::placeholders::error));
-	Engine::instance()->runContext();
+	_timer = Engine::instance()->getTimerWheel().schedule(advertiserRate * 1000, [&] {
+		advertise();
+	});
 }
 
 asio::ip::address Advertiser::getOutboundInterfaceIP() {
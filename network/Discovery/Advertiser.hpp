@@ -15,6 +15,7 @@
 
 #include "../network.hpp"
 #include "../Endpoint.hpp"
+#include "../TimerWheel.hpp"
 
 namespace asio = boost::asio;
 
@@ -50,7 +51,7 @@ protected:
 
 	/// Effectively emits the advertisement on the network
 	/// Method called regularly by the timer
-	void advertise(const boost::system::error_code &e);
+	void advertise();
 
 	/// The buffer holding data about this machine and being emitted on the network regularly
 	asio::streambuf _outputBuffer;
@@ -63,8 +64,8 @@ protected:
 	/// The socket on which we are emitting
 	asio::ip::udp::socket * _socket = nullptr;
 
-	/// The timer
-	asio::deadline_timer * _timer = nullptr;
+	/// The timer of the next advertisement
+	TimerWheel::TimerID _timer = 0;
 };
 
 } /* ::network */
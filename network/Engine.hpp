@@ -16,6 +16,7 @@
 
 #include "network.hpp"
 #include "Endpoint.hpp"
+#include "TimerWheel.hpp"
 
 namespace asio = boost::asio;
 
@@ -56,8 +57,19 @@ public:
 	/// Run the asio context on another context for asynchronous networking. This emthod handles calling run on an already running context. Basically, you should call this method everytime you finish setting up new services
 	void runContext();
 
+	/// Tell if the caller is running on the thread of the asio context
+	inline bool isContextThread() {
+		return _ioContext.get_executor().running_in_this_thread();
+	}
+
 	std::vector<asio::ip::address> getOutboundInterfaces();
 
+	/// Gives the timer wheel shared by all the sockets, servers and
+	/// advertisers. Timers run on the context thread.
+	inline TimerWheel & getTimerWheel() {
+		return _timerWheel;
+	}
+
 	inline void stopContext() {
 		_guard.reset();
 		_ioContext.stop();
@@ -68,7 +80,7 @@ public:
 
 private:
 
-	Engine(): _guard(boost::asio::make_work_guard(_ioContext)) {}
+	Engine(): _guard(boost::asio::make_work_guard(_ioContext)), _timerWheel(_ioContext) {}
 
 	// MARK: - Singleton Properties
 
@@ -82,6 +94,9 @@ private:
 
 	boost::asio::executor_work_guard<boost::asio::io_context::executor_type> _guard;
 
+	/// The timers of the engine
+	TimerWheel _timerWheel;
+
 	/// The thread on which the asio context is running
 	std::thread * _executionThread = nullptr;
 
@@ -0,0 +1,56 @@
+//
+//  MessageRegistry.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-08.
+//
+
+#include "MessageRegistry.hpp"
+
+namespace network {
+
+MessageRegistry * MessageRegistry::_instance = nullptr;
+
+constexpr MessageRegistry::TypeID MessageRegistry::undefined;
+
+MessageRegistry::MessageRegistry() {
+	// Messages used by the library itself
+	registerType<messages::Ping>(1);
+	registerType<messages::Endpoint>(2);
+}
+
+MessageRegistry::TypeID MessageRegistry::typeID(const protobuf::Descriptor * descriptor) const {
+	auto it = _typeIDs.find(descriptor);
+
+	if(it == _typeIDs.end())
+		return undefined;
+
+	return it->second;
+}
+
+const protobuf::Message * MessageRegistry::prototype(const TypeID &typeID) const {
+	auto it = _prototypes.find(typeID);
+
+	if(it == _prototypes.end())
+		return nullptr;
+
+	return it->second;
+}
+
+protobuf::Message * MessageRegistry::unpack(const messages::Datagram &datagram) const {
+	const protobuf::Message * messagePrototype = prototype(datagram.payload_type());
+
+	if(messagePrototype == nullptr)
+		return nullptr;
+
+	protobuf::Message * message = messagePrototype->New();
+
+	if(!message->ParseFromString(datagram.payload())) {
+		delete message;
+		return nullptr;
+	}
+
+	return message;
+}
+
+} /* ::network */
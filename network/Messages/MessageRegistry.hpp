@@ -0,0 +1,144 @@
+//
+//  MessageRegistry.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-08.
+//
+
+#ifndef MessageRegistry_hpp
+#define MessageRegistry_hpp
+
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+#include <google/protobuf/message.h>
+
+#include "network.pb.h"
+
+namespace protobuf = google::protobuf;
+
+namespace network {
+
+/// The message registry maps protobuf message types to small integer ids.
+///
+/// Registered messages can be packed in a `messages::Datagram` using only their
+/// id and their serialized bytes, instead of a `google.protobuf.Any` holding the
+/// full type URL. Ids are resolved without any descriptor lookup.
+///
+/// Types must be registered at startup, with the same ids on all the machines,
+/// before any socket starts exchanging them. Ids 0 to 9 are reserved.
+class MessageRegistry {
+public:
+
+	using TypeID = uint32_t;
+
+	/// Id given to unregistered types
+	static constexpr TypeID undefined = 0;
+
+	// MARK: - Singleton
+
+	/// Singleton accessor
+	static MessageRegistry * instance() {
+		if(_instance == nullptr)
+			_instance = new MessageRegistry();
+
+		return _instance;
+	}
+
+	// MARK: - Registration
+
+	/// Registers the given message type with the given id.
+	/// @param typeID Id of the type, shared by all machines. Must be above 9
+	template<class MessageType>
+	void registerType(const TypeID &typeID) {
+		static_assert(std::is_base_of<protobuf::Message, MessageType>::value, "The registered type is not derived from a protobuf messsage");
+
+		idOf<MessageType>() = typeID;
+		_prototypes[typeID] = &MessageType::default_instance();
+		_typeIDs[MessageType::descriptor()] = typeID;
+	}
+
+	/// Gives the id of the given message type
+	/// @return The id of the type, or `undefined` if the type is not registered
+	template<class MessageType>
+	inline TypeID typeID() const {
+		return idOf<MessageType>();
+	}
+
+	/// Gives the id of the type with the given descriptor
+	/// @return The id of the type, or `undefined` if the type is not registered
+	TypeID typeID(const protobuf::Descriptor * descriptor) const;
+
+	/// Gives the default instance of the type with the given id
+	/// @return The prototype, or nullptr if no type is registered with this id
+	const protobuf::Message * prototype(const TypeID &typeID) const;
+
+	// MARK: - Packing
+
+	/// Packs the given message as the payload of the given datagram
+	/// @return False if the message type is not registered
+	template<class MessageType>
+	bool pack(const MessageType &message, messages::Datagram &datagram) const {
+		const TypeID id = typeID<MessageType>();
+
+		if(id == undefined)
+			return false;
+
+		datagram.set_payload_type(id);
+		message.SerializeToString(datagram.mutable_payload());
+
+		return true;
+	}
+
+	/// Tell if the payload of the given datagram is of the given type
+	template<class MessageType>
+	bool is(const messages::Datagram &datagram) const {
+		if(datagram.payload_type() != undefined)
+			return datagram.payload_type() == typeID<MessageType>();
+
+		return datagram.data().Is<MessageType>();
+	}
+
+	/// Unpacks the payload of the given datagram in the given message. Payloads
+	/// packed in a `google.protobuf.Any` are supported as well.
+	/// @return False if the payload is not of the given type or could not be parsed
+	template<class MessageType>
+	bool unpack(const messages::Datagram &datagram, MessageType &message) const {
+		if(datagram.payload_type() == undefined)
+			return datagram.data().UnpackTo(&message);
+
+		if(datagram.payload_type() != typeID<MessageType>())
+			return false;
+
+		return message.ParseFromString(datagram.payload());
+	}
+
+	/// Unpacks the payload of the given datagram in a new message of the registered type.
+	/// @return The message, to be freed by the caller, or nullptr if the payload type is unknown
+	protobuf::Message * unpack(const messages::Datagram &datagram) const;
+
+private:
+
+	MessageRegistry();
+
+	/// The singleton instance of the registry
+	static MessageRegistry * _instance;
+
+	/// Storage for the id of each message type
+	template<class MessageType>
+	static TypeID & idOf() {
+		static TypeID typeID = undefined;
+		return typeID;
+	}
+
+	/// Default instance of each registered type, by id
+	std::unordered_map<TypeID, const protobuf::Message *> _prototypes;
+
+	/// Id of each registered type, by descriptor
+	std::unordered_map<const protobuf::Descriptor *, TypeID> _typeIDs;
+};
+
+} /* ::network */
+
+#endif /* MessageRegistry_hpp */
@@ -0,0 +1,14 @@
+//
+//  RPC.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef RPC_h
+#define RPC_h
+
+#include "RPC/RPCChannel.hpp"
+
+#endif /* RPC_h */
@@ -0,0 +1,357 @@
+//
+//  RPCChannel.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <vector>
+
+#include <common/log.hpp>
+
+#include "RPCChannel.hpp"
+
+#include "../Engine.hpp"
+
+namespace network {
+
+// MARK: - Lifecycle
+
+RPCChannel::RPCChannel(Socket<messages::Datagram> * socket): _socket(socket) {
+	delegate = socket->delegate;
+	socket->delegate = this;
+}
+
+RPCChannel::~RPCChannel() {
+	Socket<messages::Datagram> * socket = _socket;
+
+	if(socket && socket->delegate == this)
+		socket->delegate = delegate;
+
+	completeAll(RPCStatus::closed);
+}
+
+// MARK: - Calls
+
+RPCChannel::CallID RPCChannel::call(messages::Datagram request, ResultHandler onResult, const unsigned int &deadline, const Lane &lane) {
+	const CallID callID = _nextCallID++;
+	Socket<messages::Datagram> * socket = _socket;
+
+	// The remote handles the lower types as system datagrams, and would never answer
+	if(request.type() < 10) {
+		LOG_WARN("Remote calls cannot use the system datagram type " + std::to_string(request.type()));
+
+		RPCResult result;
+		result.status = RPCStatus::error;
+		result.error = "Requests must have a type above 9";
+
+		if(onResult)
+			onResult(result);
+
+		return callID;
+	}
+
+	if(!socket || socket->getStatus() != SocketStatus::ready) {
+		RPCResult result;
+		result.status = RPCStatus::closed;
+
+		if(onResult)
+			onResult(result);
+
+		return callID;
+	}
+
+	request.set_request_id(callID);
+	request.set_response_id(0);
+
+	// The socket does not own the request, to tell the channel if it drops it
+	messages::Datagram * sending = new messages::Datagram(std::move(request));
+	const bool isSync = socket->getEmissionType() == EmissionType::sync;
+
+	bool isClosed;
+
+	// The call waits before the request is sent, its response may come before
+	// the send returns
+	{
+		std::lock_guard<std::mutex> lock(_callsMutex);
+
+		PendingCall &pending = _pendingCalls[callID];
+		pending.onResult = std::move(onResult);
+
+		if(deadline > 0) {
+			pending.deadlineTimer = Engine::instance()->getTimerWheel().schedule(deadline, [this, callID] {
+				RPCResult result;
+				result.status = RPCStatus::timedOut;
+
+				complete(callID, result);
+			});
+		}
+
+		_sendingRequests[sending] = {callID, std::unique_ptr<messages::Datagram>(sending)};
+
+		// The socket may have closed since it was checked, after failing the
+		// waiting calls
+		isClosed = _socket == nullptr;
+	}
+
+	if(isClosed) {
+		CallID sentID;
+		releaseRequest(sending, sentID);
+
+		RPCResult result;
+		result.status = RPCStatus::closed;
+
+		complete(callID, result);
+		return callID;
+	}
+
+	socket->send(sending, lane);
+
+	// Synchronous sockets are done with the request once it returns
+	if(isSync) {
+		CallID sentID;
+		releaseRequest(sending, sentID);
+	}
+
+	return callID;
+}
+
+std::future<RPCResult> RPCChannel::call(messages::Datagram request, const unsigned int &deadline, const Lane &lane) {
+	std::shared_ptr<std::promise<RPCResult>> promise = std::make_shared<std::promise<RPCResult>>();
+
+	call(std::move(request), [promise] (const RPCResult &result) {
+		promise->set_value(result);
+	}, deadline, lane);
+
+	return promise->get_future();
+}
+
+bool RPCChannel::cancel(const CallID &callID) {
+	RPCResult result;
+	result.status = RPCStatus::cancelled;
+
+	return complete(callID, result);
+}
+
+std::size_t RPCChannel::getPendingCount() {
+	std::lock_guard<std::mutex> lock(_callsMutex);
+	return _pendingCalls.size();
+}
+
+bool RPCChannel::complete(const CallID &callID, const RPCResult &result) {
+	ResultHandler onResult;
+
+	{
+		std::lock_guard<std::mutex> lock(_callsMutex);
+
+		auto it = _pendingCalls.find(callID);
+
+		if(it == _pendingCalls.end())
+			return false;
+
+		Engine::instance()->getTimerWheel().cancel(it->second.deadlineTimer);
+		onResult = std::move(it->second.onResult);
+
+		_pendingCalls.erase(it);
+	}
+
+	// The handler is called without the lock, it may make other calls
+	if(onResult)
+		onResult(result);
+
+	return true;
+}
+
+void RPCChannel::completeAll(const RPCStatus &status) {
+	std::vector<CallID> callIDs;
+
+	{
+		std::lock_guard<std::mutex> lock(_callsMutex);
+		callIDs.reserve(_pendingCalls.size());
+
+		for(const auto &pending: _pendingCalls)
+			callIDs.push_back(pending.first);
+	}
+
+	RPCResult result;
+	result.status = status;
+
+	for(const CallID &callID: callIDs)
+		complete(callID, result);
+}
+
+bool RPCChannel::releaseRequest(const protobuf::Message * message, CallID &callID) {
+	std::lock_guard<std::mutex> lock(_callsMutex);
+
+	auto it = _sendingRequests.find(message);
+
+	if(it == _sendingRequests.end())
+		return false;
+
+	callID = it->second.callID;
+	_sendingRequests.erase(it);
+
+	return true;
+}
+
+// MARK: - Requests
+
+void RPCChannel::setHandler(const uint64_t &type, RequestHandler handler) {
+	std::lock_guard<std::mutex> lock(_handlersMutex);
+
+	if(!handler) {
+		_handlers.erase(type);
+		return;
+	}
+
+	_handlers[type] = std::move(handler);
+}
+
+void RPCChannel::answer(const messages::Datagram &request) {
+	RequestHandler handler;
+
+	_handlersMutex.lock();
+
+	auto it = _handlers.find(request.type());
+
+	if(it != _handlers.end())
+		handler = it->second;
+
+	_handlersMutex.unlock();
+
+	messages::Datagram response;
+
+	if(!handler) {
+		LOG_WARN("No handler for remote calls of type " + std::to_string(request.type()));
+		response.set_error("No handler for requests of type " + std::to_string(request.type()));
+	} else if(!handler(request, response) && response.error().empty()) {
+		response.set_error("The request failed");
+	}
+
+	response.set_type(request.type());
+	response.set_request_id(0);
+	response.set_response_id(request.request_id());
+
+	Socket<messages::Datagram> * socket = _socket;
+
+	if(socket)
+		socket->send(std::move(response));
+}
+
+// MARK: - Internal
+
+void RPCChannel::onDatagram(const messages::Datagram &datagram, std::shared_ptr<const messages::Datagram> owned) {
+	if(datagram.request_id() != 0)
+		return answer(datagram);
+
+	RPCResult result;
+
+	if(!datagram.error().empty()) {
+		result.status = RPCStatus::error;
+		result.error = datagram.error();
+	} else {
+		// Transient datagrams are only valid during the reception, keep a copy
+		result.response = owned ? owned : std::make_shared<const messages::Datagram>(datagram);
+	}
+
+	// Late responses, of calls cancelled or timed out, are dropped
+	complete(datagram.response_id(), result);
+}
+
+void RPCChannel::socketDidReceive(BaseSocket * socket, const protobuf::Message * message) {
+	const messages::Datagram * datagram = static_cast<const messages::Datagram *>(message);
+
+	if(isPartOfCall(*datagram))
+		return onDatagram(*datagram, std::shared_ptr<const messages::Datagram>(datagram));
+
+	// The delegate takes ownership of the message
+	if(delegate)
+		return delegate->socketDidReceive(socket, message);
+
+	delete message;
+}
+
+void RPCChannel::socketDidReceiveTransient(BaseSocket * socket, const protobuf::Message &message) {
+	const messages::Datagram &datagram = static_cast<const messages::Datagram &>(message);
+
+	if(isPartOfCall(datagram))
+		return onDatagram(datagram, nullptr);
+
+	if(delegate)
+		delegate->socketDidReceiveTransient(socket, message);
+}
+
+void RPCChannel::socketDidClose(BaseSocket * socket) {
+	// The socket may be released by the delegate, calls made from now on fail
+	_socket = nullptr;
+
+	completeAll(RPCStatus::closed);
+
+	if(delegate)
+		delegate->socketDidClose(socket);
+}
+
+void RPCChannel::socketDidOpen(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidOpen(socket);
+}
+
+void RPCChannel::socketDidFailToConnect(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidFailToConnect(socket);
+}
+
+void RPCChannel::socketDidSendAsynchronously(BaseSocket * socket, const protobuf::Message * message) {
+	CallID callID;
+
+	if(releaseRequest(message, callID))
+		return;
+
+	if(delegate)
+		delegate->socketDidSendAsynchronously(socket, message);
+}
+
+void RPCChannel::socketDidDropMessage(BaseSocket * socket, const protobuf::Message * message) {
+	CallID callID;
+
+	if(releaseRequest(message, callID)) {
+		// Requests dropped by the overflow policy will never be answered.
+		// Requests dropped on close fail with the other calls.
+		RPCResult result;
+		result.status = socket->getStatus() == SocketStatus::ready ? RPCStatus::dropped : RPCStatus::closed;
+
+		complete(callID, result);
+		return;
+	}
+
+	if(delegate)
+		delegate->socketDidDropMessage(socket, message);
+}
+
+void RPCChannel::socketDidReachHighWatermark(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidReachHighWatermark(socket);
+}
+
+void RPCChannel::socketDidReachLowWatermark(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidReachLowWatermark(socket);
+}
+
+void RPCChannel::socketDidSuspectRemote(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidSuspectRemote(socket);
+}
+
+void RPCChannel::socketDidRecoverRemote(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidRecoverRemote(socket);
+}
+
+void RPCChannel::socketDidLoseRemote(BaseSocket * socket) {
+	if(delegate)
+		delegate->socketDidLoseRemote(socket);
+}
+
+} /* ::network */
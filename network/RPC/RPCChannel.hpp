@@ -0,0 +1,258 @@
+//
+//  RPCChannel.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef RPCChannel_hpp
+#define RPCChannel_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../Messages/network.pb.h"
+#include "../Messages/MessageRegistry.hpp"
+#include "../Socket/Socket.hpp"
+#include "../Socket/SocketDelegate.hpp"
+#include "../TimerWheel.hpp"
+
+namespace network {
+
+/// Outcome of a remote call
+enum class RPCStatus {
+	/// The remote answered the request
+	ok,
+
+	/// The remote failed to handle the request
+	error,
+
+	/// No response came before the deadline of the call
+	timedOut,
+
+	/// The call was cancelled by the caller
+	cancelled,
+
+	/// The connection closed before a response came
+	closed,
+
+	/// The socket dropped the request, its queue being full
+	dropped
+};
+
+/// The result of a remote call
+struct RPCResult {
+	RPCStatus status = RPCStatus::ok;
+
+	/// The response of the remote, set if the status is `ok`
+	std::shared_ptr<const messages::Datagram> response;
+
+	/// The reason of the failure, given by the remote
+	std::string error;
+};
+
+/// A RPCChannel makes remote calls over a `Socket<messages::Datagram>`, and
+/// answers the calls of the remote.
+///
+/// Requests and responses are datagrams. Every request carries an id, given
+/// back in its response, so any number of calls can wait for their responses
+/// at the same time, answered in any order. A call completes exactly once:
+/// with its response, or when its deadline passes, it is cancelled, or the
+/// connection closes.
+///
+/// The channel becomes the delegate of the socket. Datagrams that are not
+/// part of a call, and all the socket events, are passed along to the
+/// previous delegate of the socket. Callbacks are run on the network thread,
+/// where futures must not be waited on.
+class RPCChannel: public SocketDelegate {
+public:
+
+	/// Identifies a call
+	using CallID = uint64_t;
+
+	/// Called once with the result of a call
+	using ResultHandler = std::function<void(const RPCResult &)>;
+
+	/// Handles the requests of a type. Fills the response and returns true, or
+	/// returns false with the reason in the response `error` field.
+	using RequestHandler = std::function<bool(const messages::Datagram &, messages::Datagram &)>;
+
+	// MARK: - Lifecycle
+
+	/// Creates a channel over the given socket, taking its place as its delegate
+	/// @param socket The socket exchanging the calls
+	RPCChannel(Socket<messages::Datagram> * socket);
+
+	/// Fails the waiting calls, and gives the socket back to its delegate if
+	/// it is still open. The socket must be closed, or done sending the requests of the
+	/// channel, before the channel is destroyed.
+	virtual ~RPCChannel();
+
+	// MARK: - Calls
+
+	/// Sends the given request to the remote
+	/// @param request The request. Its type must be above 9, lower types are
+	/// system datagrams and fail the call with the `error` status.
+	/// @param onResult Called with the result of the call
+	/// @param deadline Delay in milliseconds to wait for the response, 0 to wait
+	/// until the connection closes
+	/// @param lane The priority lane of the request
+	/// @return The id of the call, to cancel it
+	CallID call(messages::Datagram request, ResultHandler onResult, const unsigned int &deadline = rpcDeadline, const Lane &lane = normalLane);
+
+	/// Sends the given request to the remote
+	/// @param request The request. Its type must be above 9, lower types are
+	/// system datagrams and fail the call with the `error` status.
+	/// @param deadline Delay in milliseconds to wait for the response, 0 to wait
+	/// until the connection closes
+	/// @param lane The priority lane of the request
+	/// @return The future result of the call
+	std::future<RPCResult> call(messages::Datagram request, const unsigned int &deadline = rpcDeadline, const Lane &lane = normalLane);
+
+	/// Sends the given message to the remote, packed in a request of the
+	/// given type. The message type must be registered in the `MessageRegistry`.
+	/// @param type The type of the request, above 9
+	/// @param message The message to send
+	/// @param onResult Called with the result of the call
+	/// @param deadline Delay in milliseconds to wait for the response
+	/// @return The id of the call, or 0 if the message type is not registered
+	template<class MessageType>
+	CallID call(const uint64_t &type, const MessageType &message, ResultHandler onResult, const unsigned int &deadline = rpcDeadline) {
+		messages::Datagram request;
+		request.set_type(type);
+
+		if(!MessageRegistry::instance()->pack(message, request))
+			return 0;
+
+		return call(std::move(request), std::move(onResult), deadline);
+	}
+
+	/// Cancels the given call. Its result handler is called with the
+	/// `cancelled` status, and its response is ignored.
+	/// @param callID The id of the call
+	/// @return False if the call already completed
+	bool cancel(const CallID &callID);
+
+	/// Gives the number of calls waiting for a response
+	std::size_t getPendingCount();
+
+	// MARK: - Requests
+
+	/// Sets the handler answering the requests of the given type. Requests
+	/// without handler are answered with an error.
+	/// @param type The type of the requests
+	/// @param handler The request handler, nullptr to remove it
+	void setHandler(const uint64_t &type, RequestHandler handler);
+
+	// MARK: - Properties
+
+	/// The delegate receiving everything that is not part of a call
+	SocketDelegate * delegate = nullptr;
+
+	/// Gives the socket of the channel, nullptr once it closed
+	inline Socket<messages::Datagram> * getSocket() const { return _socket; }
+
+protected:
+
+	// MARK: - Internal
+
+	virtual void socketDidOpen(BaseSocket * socket) override;
+
+	virtual void socketDidFailToConnect(BaseSocket * socket) override;
+
+	virtual void socketDidReceive(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidReceiveTransient(BaseSocket * socket, const protobuf::Message &message) override;
+
+	virtual void socketDidSendAsynchronously(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidDropMessage(BaseSocket * socket, const protobuf::Message * message) override;
+
+	virtual void socketDidReachHighWatermark(BaseSocket * socket) override;
+
+	virtual void socketDidReachLowWatermark(BaseSocket * socket) override;
+
+	virtual void socketDidSuspectRemote(BaseSocket * socket) override;
+
+	virtual void socketDidRecoverRemote(BaseSocket * socket) override;
+
+	virtual void socketDidLoseRemote(BaseSocket * socket) override;
+
+	virtual void socketDidClose(BaseSocket * socket) override;
+
+private:
+
+	/// Cleared when the socket closes, as it may be released afterward
+	std::atomic<Socket<messages::Datagram> *> _socket;
+
+	/// A call waiting for its response
+	struct PendingCall {
+		ResultHandler onResult;
+
+		/// Fails the call at its deadline
+		TimerWheel::TimerID deadlineTimer = 0;
+	};
+
+	/// Protects the pending calls
+	std::mutex _callsMutex;
+
+	std::unordered_map<CallID, PendingCall> _pendingCalls;
+
+	/// A request given to the socket
+	struct SendingRequest {
+		CallID callID;
+
+		std::unique_ptr<messages::Datagram> request;
+	};
+
+	/// Requests the socket is not done with, by their address. They are given
+	/// as raw pointers, for the socket to tell when it drops one. A request
+	/// the socket ignored while closing is freed with the channel. Protected by
+	/// the calls mutex.
+	std::unordered_map<const protobuf::Message *, SendingRequest> _sendingRequests;
+
+	/// Id of the next call. Zero is never used.
+	std::atomic<CallID> _nextCallID = {1};
+
+	/// Protects the request handlers
+	std::mutex _handlersMutex;
+
+	std::unordered_map<uint64_t, RequestHandler> _handlers;
+
+	/// Removes the given call, and gives it the given result
+	/// @return False if the call already completed
+	bool complete(const CallID &callID, const RPCResult &result);
+
+	/// Fails all the waiting calls with the given status
+	void completeAll(const RPCStatus &status);
+
+	/// Releases the given request once the socket is done with it
+	/// @param message The message given back by the socket
+	/// @param callID Set to the id of the call of the request
+	/// @return False if the message is not a request of the channel
+	bool releaseRequest(const protobuf::Message * message, CallID &callID);
+
+	/// Tell if the given datagram is a request or a response
+	inline static bool isPartOfCall(const messages::Datagram &datagram) {
+		return datagram.request_id() != 0 || datagram.response_id() != 0;
+	}
+
+	/// Answers a received request, or completes the call of a received response
+	/// @param datagram The received datagram
+	/// @param owned The datagram, if the channel can keep it
+	void onDatagram(const messages::Datagram &datagram, std::shared_ptr<const messages::Datagram> owned);
+
+	/// Answers the given request with its handler
+	void answer(const messages::Datagram &request);
+};
+
+} /* ::network */
+
+#endif /* RPCChannel_hpp */
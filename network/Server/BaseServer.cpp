@@ -5,6 +5,10 @@
 //  Created by Valentin Dufois on 2020-02-05.
 //
 
+#include <algorithm>
+#include <climits>
+#include <map>
+
 #include <boost/bind.hpp>
 #include <common/log.hpp>
 
@@ -37,14 +41,97 @@ void BaseServer::open() {
 	// Be ready to accept new connections
 	prepareAccept();
 
+	scheduleReap();
+
 	LOG_INFO(Endpoint(_type).type + " Server opened on port " + std::to_string(_port));
 }
 
-void BaseServer::sendToAll(protobuf::Message * aMessage) {
-	_sendCount = _connections.size();
+void BaseServer::sendToAll(protobuf::Message * aMessage, const Lane &lane) {
+	// The completion is shared by all the payloads of this broadcast, and is
+	// released once every socket is done with its payload
+	std::shared_ptr<void> completion(nullptr, [this, aMessage] (void *) {
+		if(delegate)
+			delegate->serverDidSendToAll(this, aMessage);
+	});
+
+	// Format the message only once per exchange format
+	std::map<SocketFormat, std::shared_ptr<const SharedPayload>> payloads;
+
 	for(BaseSocket * s: _connections) {
-		s->send(aMessage);
+		std::shared_ptr<const SharedPayload> &payload = payloads[s->getFormat()];
+
+		if(!payload) {
+			std::shared_ptr<SharedPayload> newPayload = std::make_shared<SharedPayload>();
+			BaseSocket::formatMessage(aMessage, s->getFormat(), newPayload->data);
+			newPayload->completion = completion;
+
+			payload = newPayload;
+		}
 	}
+
+	sendPayloadsToAll(payloads, lane);
+}
+
+std::size_t BaseServer::getBufferMemory() const {
+	std::size_t memory = 0;
+
+	for(const BaseSocket * s: _connections) {
+		memory += s->getBufferMemory();
+	}
+
+	return memory;
+}
+
+void BaseServer::sendRawToAll(const std::shared_ptr<const std::string> &data, const std::function<void()> &onSent, const Lane &lane) {
+	std::shared_ptr<void> completion;
+
+	if(onSent)
+		completion = std::shared_ptr<void>(nullptr, [onSent] (void *) { onSent(); });
+
+	// Frame the bytes only once per exchange format
+	std::map<SocketFormat, std::shared_ptr<const SharedPayload>> payloads;
+
+	for(BaseSocket * s: _connections) {
+		std::shared_ptr<const SharedPayload> &payload = payloads[s->getFormat()];
+
+		if(!payload) {
+			std::shared_ptr<SharedPayload> newPayload = BaseSocket::makeRawPayload(data, s->getFormat());
+			newPayload->completion = completion;
+
+			payload = newPayload;
+		}
+	}
+
+	sendPayloadsToAll(payloads, lane);
+}
+
+void BaseServer::sendPayloadsToAll(const std::map<SocketFormat, std::shared_ptr<const SharedPayload>> &payloads, const Lane &lane) {
+	// Sockets closed by their overflow policy are removed from the connections
+	const std::vector<BaseSocket *> connections = _connections;
+
+	for(BaseSocket * s: connections) {
+		const std::shared_ptr<const SharedPayload> &payload = payloads.at(s->getFormat());
+
+		// A stalled client must not block the others
+		if(s->getOverflowPolicy() == OverflowPolicy::block && lane != controlLane && !s->canQueue(payload->size())) {
+			++s->_droppedCount;
+			continue;
+		}
+
+		s->send(payload, lane);
+	}
+}
+
+void BaseServer::setIdleTimeouts(const unsigned int &readTimeout, const unsigned int &writeTimeout) {
+	_readIdleTimeout = readTimeout;
+	_writeIdleTimeout = writeTimeout;
+
+	_reapMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_reapTimer);
+	_reapMutex.unlock();
+
+	if(_isRunning)
+		scheduleReap();
 }
 
 void BaseServer::socketDidOpen(BaseSocket * socket) { }
@@ -56,20 +143,66 @@ void BaseServer::socketDidClose(BaseSocket * socket) {
 	// The socket is closed, remove it from the array of connections
 	_connections.erase(std::find(_connections.begin(), _connections.end(), socket));
 
-	delete socket;
+	// The handlers of its aborted operations may still be waiting to run
+	socket->delegate = nullptr;
+	BaseSocket::release(socket);
 }
-void BaseServer::socketDidSendAsynchronously(BaseSocket *, const protobuf::Message * message) {
-	if(--_sendCount > 0)
+
+void BaseServer::scheduleReap() {
+	if(_readIdleTimeout == 0 && _writeIdleTimeout == 0)
 		return;
 
-	// send count is empty, tell delegate
-	if(delegate)
-		delegate->serverDidSendToAll(this, message);
+	// Connections are closed at most a fraction of their timeout late
+	unsigned int interval = std::min(_readIdleTimeout == 0 ? UINT_MAX : _readIdleTimeout,
+									 _writeIdleTimeout == 0 ? UINT_MAX : _writeIdleTimeout);
+	interval = std::max(interval / idleCheckRate, 1u);
+
+	std::lock_guard<std::mutex> lock(_reapMutex);
+
+	Engine::instance()->getTimerWheel().cancel(_reapTimer);
+	_reapTimer = Engine::instance()->getTimerWheel().schedule(interval, [&] {
+		if(!_isRunning)
+			return;
+
+		reapIdleConnections();
+		scheduleReap();
+	});
+}
+
+void BaseServer::reapIdleConnections() {
+	const int64_t now = ClockEstimator::now();
+	const int64_t readTimeout = (int64_t)_readIdleTimeout * 1000000;
+	const int64_t writeTimeout = (int64_t)_writeIdleTimeout * 1000000;
+
+	// Closed sockets are removed from the connections
+	const std::vector<BaseSocket *> connections = _connections;
+
+	for(BaseSocket * s: connections) {
+		if(s->getStatus() != SocketStatus::ready)
+			continue;
+
+		if(readTimeout > 0 && now - s->getLastReceiveTime() > readTimeout) {
+			LOG_INFO("Closing connection with " + s->getRemote().uri() + ", nothing received for " + std::to_string(_readIdleTimeout) + "ms");
+
+			++_readReapedCount;
+			s->close();
+			continue;
+		}
+
+		if(writeTimeout > 0 && s->isSending() && now - s->getLastSendTime() > writeTimeout) {
+			LOG_INFO("Closing connection with " + s->getRemote().uri() + ", stuck writing for " + std::to_string(_writeIdleTimeout) + "ms");
+
+			++_writeReapedCount;
+			s->close();
+		}
+	}
 }
 
 void BaseServer::prepareAccept() {
 	BaseSocket * newConnection = makeSocket();
 	newConnection->delegate = this;
+	newConnection->setQueueLimits(_queueMaxSize, _queueMaxCount);
+	newConnection->setOverflowPolicy(_overflowPolicy);
 
 	_acceptor->async_accept(newConnection->getSocket(), boost::bind(&BaseServer::handleAccept, this, newConnection, boost::asio::placeholders::error));
 }
@@ -96,13 +229,20 @@ BaseServer::~BaseServer() {
 	// Perform stopping actions...
 	_isRunning = false;
 
+	_reapMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_reapTimer);
+	_reapMutex.unlock();
+
 	_acceptor->cancel();
 	_acceptor->close();
 	delete _acceptor;
 
 	for(BaseSocket * socket: _connections) {
-		if(socket != nullptr)
-			delete socket;
+		if(socket == nullptr)
+			continue;
+
+		socket->delegate = nullptr;
+		BaseSocket::release(socket);
 	}
 
 	_connections.clear();
@@ -8,10 +8,19 @@
 #ifndef BaseServer_hpp
 #define BaseServer_hpp
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../Socket/SharedPayload.hpp"
 #include "../Socket/SocketStatus.hpp"
 #include "../Socket/SocketDelegate.hpp"
 
 #include "../Discovery/Advertiser.hpp"
+#include "../TimerWheel.hpp"
 
 namespace asio = boost::asio;
 namespace protobuf = google::protobuf;
@@ -48,9 +57,24 @@ public:
 
 	void open();
 
-	/// Sends the given message to all the connected sockets
+	/// Sends the given message to all the connected sockets.
+	///
+	/// The message is formatted only once per exchange format in use, and the
+	/// formatted bytes are shared by all the sockets. The delegate is notified
+	/// with `serverDidSendToAll` once every socket is done sending it.
+	///
+	/// Sockets with a full queue apply their overflow policy, except `block`:
+	/// the message is dropped for them, to never stall the other sockets.
 	/// @param aMessage A message to send
-	void sendToAll(protobuf::Message * aMessage);
+	/// @param lane The priority lane of the message
+	void sendToAll(protobuf::Message * aMessage, const Lane &lane = normalLane);
+
+	/// Sends the given serialized message to all the connected sockets, without
+	/// parsing nor copying it. See `BaseSocket::sendRaw`.
+	/// @param data The serialized message
+	/// @param onSent Called once every socket is done with the bytes
+	/// @param lane The priority lane of the message
+	void sendRawToAll(const std::shared_ptr<const std::string> &data, const std::function<void()> &onSent = nullptr, const Lane &lane = normalLane);
 
 	/// Start the advertiser, exposing explicitely the server on the network
 	inline void advertise() { _advertiser.startAdvertising(); }
@@ -64,26 +88,73 @@ protected:
 
 	virtual void socketDidClose(BaseSocket * socket) override;
 
-	virtual void socketDidSendAsynchronously(BaseSocket *, const protobuf::Message *) override;
-
 public:
 
 	~BaseServer();
 
 	// MARK: - Properties
 
-	ServerDelegate * delegate;
+	ServerDelegate * delegate = nullptr;
 
 	/// Tell if the server is running
 	/// @return True if running, false otherwise
 	inline bool isRunning() { return _isRunning; }
 
+	/// Gives the number of bytes of buffer memory held by all the connections
+	std::size_t getBufferMemory() const;
+
 	inline SocketFormat getEmissionFormat() { return _emissionFormat; }
 
 	inline void setEmissionFormat(const SocketFormat &aFormat) {
 		_emissionFormat = aFormat;
 	}
 
+	/// Sets the queue limits of the sockets of the server. Only applies to
+	/// sockets opened afterward. See `BaseSocket::setQueueLimits`.
+	/// @param maxSize Size in bytes of the waiting messages, 0 for no limit
+	/// @param maxCount Number of waiting messages, 0 for no limit
+	inline void setQueueLimits(const std::size_t &maxSize, const std::size_t &maxCount) {
+		_queueMaxSize = maxSize;
+		_queueMaxCount = maxCount;
+	}
+
+	inline OverflowPolicy getOverflowPolicy() { return _overflowPolicy; }
+
+	/// Sets the overflow policy of the sockets of the server. Only applies to
+	/// sockets opened afterward.
+	/// @param policy An overflow policy
+	inline void setOverflowPolicy(const OverflowPolicy &policy) {
+		_overflowPolicy = policy;
+	}
+
+	/// Sets the inactivity timeouts of the connections. Connections staying
+	/// idle longer are closed and released.
+	///
+	/// A connection is read-idle when nothing was received from its remote,
+	/// and write-idle when a write waits for the remote to read, without
+	/// making any progress. All the connections are checked together a few times per
+	/// timeout.
+	/// @param readTimeout Delay in milliseconds, 0 for no limit
+	/// @param writeTimeout Delay in milliseconds, 0 for no limit
+	void setIdleTimeouts(const unsigned int &readTimeout, const unsigned int &writeTimeout);
+
+	/// Gives the delay in milliseconds after which a connection that received
+	/// nothing is closed, 0 if none
+	inline unsigned int getReadIdleTimeout() const { return _readIdleTimeout; }
+
+	/// Gives the delay in milliseconds after which a connection stuck writing
+	/// is closed, 0 if none
+	inline unsigned int getWriteIdleTimeout() const { return _writeIdleTimeout; }
+
+	/// Gives the number of connections closed for being idle
+	inline std::size_t getReapedCount() const { return _readReapedCount + _writeReapedCount; }
+
+	/// Gives the number of connections closed for receiving nothing
+	inline std::size_t getReadReapedCount() const { return _readReapedCount; }
+
+	/// Gives the number of connections closed for being stuck writing
+	inline std::size_t getWriteReapedCount() const { return _writeReapedCount; }
+
 protected:
 
 	// The type of the server
@@ -103,7 +174,17 @@ private:
 
 	SocketFormat _emissionFormat = SocketFormat::protobuf;
 
-	unsigned short _sendCount = 0;
+	std::size_t _queueMaxSize = serverQueueMaxSize;
+
+	std::size_t _queueMaxCount = queueMaxCount;
+
+	/// A stalled client only loses its own messages
+	OverflowPolicy _overflowPolicy = OverflowPolicy::dropNewest;
+
+	/// Sends the given payload to all the connected sockets
+	/// @param payloads The payload to send, by exchange format
+	/// @param lane The priority lane of the payloads
+	void sendPayloadsToAll(const std::map<SocketFormat, std::shared_ptr<const SharedPayload>> &payloads, const Lane &lane);
 
 	/// The acceptor used to accept incoming connections
 	asio::ip::tcp::acceptor * _acceptor = nullptr;
@@ -117,6 +198,27 @@ private:
 	/// Holds a reference to all the connection to this server
 	std::vector<BaseSocket *> _connections;
 
+	// MARK: Idle connections
+
+	unsigned int _readIdleTimeout = 0;
+
+	unsigned int _writeIdleTimeout = 0;
+
+	/// Checks the connections for idleness
+	TimerWheel::TimerID _reapTimer = 0;
+
+	std::mutex _reapMutex;
+
+	std::atomic<std::size_t> _readReapedCount = {0};
+
+	std::atomic<std::size_t> _writeReapedCount = {0};
+
+	/// Schedules the next check of the connections, if a timeout is set
+	void scheduleReap();
+
+	/// Closes the connections idle for too long
+	void reapIdleConnections();
+
 	/// The underlying advertiser used to adveretise this server on the network
 	Advertiser _advertiser;
 };
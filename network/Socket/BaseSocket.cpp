@@ -7,10 +7,25 @@
 
 #include "Socket.hpp"
 
+#include <cerrno>
+#include <chrono>
+#include <climits>
+
+#include <poll.h>
+#include <sys/socket.h>
+
 #include <common/log.hpp>
 
 namespace network {
 
+// The socket is written without blocking, and without raising SIGPIPE where
+// the platform allows it per call
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+static constexpr int sendFlags = MSG_DONTWAIT;
+#endif
+
 // MARK: - BaseSocket
 
 void BaseSocket::connectTo(const std::string &ip, const NetworkPort &port) {
@@ -26,44 +41,130 @@ void BaseSocket::connectTo(const Endpoint &remote) {
 
 	_remote = remote;
 
-	// Open the socket
-	boost::system::error_code ec;
-	_socket.open(asio::ip::tcp::v4(), ec);
+	if(!openSocket())
+		return;
 
-	Engine::instance()->runContext();
+	LOG_DEBUG("Opening connection to " + _remote.uri());
+
+	// Connect synchronously
+	boost::system::error_code ec;
+	_socket.connect(_remote, ec);
 
 	// Check errors
 	if(ec) {
+		_status = SocketStatus::idle;
 		LOG_ERROR(ec.message());
+		_socket.shutdown(asio::socket_base::shutdown_both, ec);
+		_socket.close(ec);
+		return;
+	}
+
+	onConnected();
+}
+
+void BaseSocket::asyncConnectTo(const std::string &ip, const NetworkPort &port, const unsigned int &timeout) {
+	asyncConnectTo(Endpoint(ip, port), timeout);
+}
+
+void BaseSocket::asyncConnectTo(const Endpoint &remote, const unsigned int &timeout) {
+	if(_status != idle && _status != closed) {
+		LOG_ERROR("This socket could not be opened");
 		return;
 	}
 
+	_status = SocketStatus::connecting;
+
+	_remote = remote;
+
+	if(!openSocket()) {
+		if(delegate)
+			delegate->socketDidFailToConnect(this);
+
+		return;
+	}
 
 	LOG_DEBUG("Opening connection to " + _remote.uri());
 
-	// Connect synchronously
-	_socket.connect(_remote, ec);
+	_connectTimer = Engine::instance()->getTimerWheel().schedule(timeout, [&] {
+		LOG_ERROR("Connection to " + _remote.uri() + " timed out");
+		abortConnection();
+	});
+
+	_socket.async_connect(_remote, [&] (const boost::system::error_code &error) {
+		// The connection was aborted, and reported, by a timeout or by closing
+		// the socket. The socket may already be released.
+		if(error == asio::error::operation_aborted)
+			return;
+
+		// The connection may have been aborted right after it succeeded
+		if(_status != SocketStatus::connecting)
+			return;
+
+		if(error) {
+			LOG_ERROR(error.message());
+			abortConnection();
+			return;
+		}
+
+		Engine::instance()->getTimerWheel().cancel(_connectTimer);
+
+		onConnected();
+	});
+
+	Engine::instance()->runContext();
+}
+
+void BaseSocket::abortConnection() {
+	Engine::instance()->getTimerWheel().cancel(_connectTimer);
+
+	_status = SocketStatus::idle;
+
+	boost::system::error_code ec;
+	_socket.close(ec);
+
+	if(delegate)
+		delegate->socketDidFailToConnect(this);
+}
+
+bool BaseSocket::openSocket() {
+	boost::system::error_code ec;
+	_socket.open(asio::ip::tcp::v4(), ec);
+
+	Engine::instance()->runContext();
 
 	// Check errors
 	if(ec) {
 		_status = SocketStatus::idle;
 		LOG_ERROR(ec.message());
-		_socket.shutdown(asio::socket_base::shutdown_both, ec);
-		_socket.close(ec);
-		return;
+		return false;
 	}
 
-	LOG_INFO("Connected to " + remote.uri());
+	return true;
+}
+
+void BaseSocket::onConnected() {
+	LOG_INFO("Connected to " + _remote.uri());
 
 	prepareReceive();
 
+	_lastReceiveTime = _lastSendTime = ClockEstimator::now();
+
 	_status = SocketStatus::ready;
 
+	scheduleHeartbeat();
+	startFailureDetection();
+
+	if(_format == compressed)
+		sendCompressionHello();
+
 	if(delegate)
 		delegate->socketDidOpen(this);
 }
 
 void BaseSocket::close() {
+	if(_status == connecting)
+		return abortConnection();
+
 	if(_status != ready)
 		return;
 
@@ -75,11 +176,38 @@ void BaseSocket::close() {
 	_socket.shutdown(asio::socket_base::shutdown_both, ec);
 	_socket.close(ec);
 
+	_batchMutex.lock();
+	_batchTimer.cancel();
+	_batchMutex.unlock();
+
+	_heartbeatMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_heartbeatTimer);
+	Engine::instance()->getTimerWheel().cancel(_failureTimer);
+	_heartbeatMutex.unlock();
+
+	// Nothing left in the queue will be sent
+	dropQueuedMessages();
+
 	if(delegate)
 		delegate->socketDidClose(this);
 }
 
 BaseSocket::~BaseSocket() {
+	Engine::instance()->getTimerWheel().cancel(_connectTimer);
+
+	// The aborted connection is not reported, as for `socketDidClose`
+	if(_status == connecting) {
+		_status = SocketStatus::idle;
+
+		boost::system::error_code ec;
+		_socket.close(ec);
+	}
+
+	_heartbeatMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_heartbeatTimer);
+	Engine::instance()->getTimerWheel().cancel(_failureTimer);
+	_heartbeatMutex.unlock();
+
 	if(_status == closed)
 		return;
 
@@ -90,10 +218,165 @@ BaseSocket::~BaseSocket() {
 	close();
 }
 
+void BaseSocket::release(BaseSocket * socket) {
+	if(socket == nullptr)
+		return;
+
+	socket->close();
+
+	// Closing queued the handlers of the aborted operations, they run first
+	asio::post(Engine::instance()->getContext(), [socket] {
+		delete socket;
+	});
+
+	Engine::instance()->runContext();
+}
+
+// MARK: - Getters & Setters
+
+void BaseSocket::setUsingArena(const bool &useArena, const std::size_t &blockSize) {
+	std::lock_guard<std::mutex> lock(_receiveMutex);
+
+	_receptionArena.reset();
+	_receptionArenaBlock.reset();
+
+	if(!useArena)
+		return;
+
+	// The initial block is kept by the arena when it is reset, sparing an
+	// allocation on every reception
+	_receptionArenaBlock.reset(new char[blockSize]);
+
+	protobuf::ArenaOptions options;
+	options.initial_block = _receptionArenaBlock.get();
+	options.initial_block_size = blockSize;
+
+	_receptionArena.reset(new protobuf::Arena(options));
+}
+
+void BaseSocket::setHeartbeat(const unsigned int &interval) {
+	_heartbeatInterval = interval;
+
+	// The remote is not expected to go silent for less than a heartbeat
+	_failureDetector.setMinimumInterval((int64_t)interval * 1000000);
+
+	_heartbeatMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_heartbeatTimer);
+	_heartbeatMutex.unlock();
+
+	if(_status == SocketStatus::ready)
+		scheduleHeartbeat();
+}
+
+void BaseSocket::scheduleHeartbeat() {
+	// Pings are datagrams, they cannot be sent in JSON
+	if(_heartbeatInterval == 0 || !canPing() || _format == json || _format == ndjson)
+		return;
+
+	std::lock_guard<std::mutex> lock(_heartbeatMutex);
+
+	Engine::instance()->getTimerWheel().cancel(_heartbeatTimer);
+	_heartbeatTimer = Engine::instance()->getTimerWheel().schedule(_heartbeatInterval, [&] {
+		if(_status != SocketStatus::ready)
+			return;
+
+		ping(this);
+		scheduleHeartbeat();
+	});
+}
+
+void BaseSocket::setFailureDetection(const bool &enabled, const double &suspectPhi, const double &deadPhi, const bool &closeWhenDead) {
+	_suspectPhi = suspectPhi;
+	_deadPhi = deadPhi;
+	_closeWhenDead = closeWhenDead;
+	_detectFailures = enabled;
+
+	_heartbeatMutex.lock();
+	Engine::instance()->getTimerWheel().cancel(_failureTimer);
+	_heartbeatMutex.unlock();
+
+	if(_status == SocketStatus::ready)
+		startFailureDetection();
+}
+
+void BaseSocket::startFailureDetection() {
+	if(!_detectFailures)
+		return;
+
+	_remoteSuspected = false;
+	_remoteLost = false;
+
+	// The connection is the first arrival
+	_failureDetector.reset();
+	_failureDetector.heartbeat(ClockEstimator::now());
+
+	scheduleFailureCheck();
+}
+
+void BaseSocket::scheduleFailureCheck() {
+	std::lock_guard<std::mutex> lock(_heartbeatMutex);
+
+	Engine::instance()->getTimerWheel().cancel(_failureTimer);
+	_failureTimer = Engine::instance()->getTimerWheel().schedule(failureCheckInterval, [&] {
+		if(_status != SocketStatus::ready)
+			return;
+
+		checkFailure();
+	});
+}
+
+void BaseSocket::checkFailure() {
+	if(!_detectFailures)
+		return;
+
+	const double phi = _failureDetector.getPhi(ClockEstimator::now());
+
+	if(phi >= _deadPhi) {
+		_remoteLost = true;
+
+		LOG_WARN("Nothing received from " + _remote.uri() + " for too long, considering it gone");
+
+		if(delegate)
+			delegate->socketDidLoseRemote(this);
+
+		// Checks stop here, a lost remote does not come back
+		if(_closeWhenDead)
+			close();
+
+		return;
+	}
+
+	if(phi >= _suspectPhi && !_remoteSuspected) {
+		_remoteSuspected = true;
+
+		if(delegate)
+			delegate->socketDidSuspectRemote(this);
+	} else if(phi < _suspectPhi && _remoteSuspected) {
+		_remoteSuspected = false;
+
+		if(delegate)
+			delegate->socketDidRecoverRemote(this);
+	}
+
+	scheduleFailureCheck();
+}
+
+std::size_t BaseSocket::getBufferMemory() const {
+	std::size_t memory = _receptionBuffer.capacity() + _sendSyncData.capacity();
+
+	for(const std::string &data: _sendingData)
+		memory += data.capacity();
+
+	if(_compressor)
+		memory += _compressor->getBufferMemory() + _compressionInput.capacity();
+
+	return memory;
+}
+
 
 // MARK: - Exchanges
 
-void BaseSocket::send(const google::protobuf::Message * message) {
+void BaseSocket::send(const google::protobuf::Message * message, const Lane &lane) {
 	// Make sure the socket is ready to send data
 	if(getStatus() != SocketStatus::ready) {
 		LOG_WARN("Could not send data on a not-ready socket. The socket may not be opened yet or is already closed.");
@@ -105,9 +388,112 @@ void BaseSocket::send(const google::protobuf::Message * message) {
 			sendSync(message);
 			break;
 		case EmissionType::async:
-			sendAsync(message);
+			sendAsync(message, lane);
+			break;
+		case EmissionType::batched: {
+			QueuedMessage queued;
+			queued.message = message;
+			queued.lane = lane;
+			sendBatched(std::move(queued));
+		} break;
+	}
+}
+
+
+void BaseSocket::send(std::shared_ptr<const protobuf::Message> message, const Lane &lane) {
+	// Make sure the socket is ready to send data
+	if(getStatus() != SocketStatus::ready) {
+		LOG_WARN("Could not send data on a not-ready socket. The socket may not be opened yet or is already closed.");
+		return;
+	}
+
+	switch(getEmissionType()) {
+		case EmissionType::sync:
+			// The message is released when leaving this scope
+			sendSync(message.get());
+			break;
+		case EmissionType::async:
+			sendAsync(std::move(message), lane);
+			break;
+		case EmissionType::batched: {
+			QueuedMessage queued;
+			queued.message = message.get();
+			queued.ownedMessage = std::move(message);
+			queued.lane = lane;
+			sendBatched(std::move(queued));
+		} break;
+	}
+}
+
+void BaseSocket::send(const std::shared_ptr<const SharedPayload> &payload, const Lane &lane) {
+	// Make sure the socket is ready to send data
+	if(getStatus() != SocketStatus::ready) {
+		LOG_WARN("Could not send data on a not-ready socket. The socket may not be opened yet or is already closed.");
+		return;
+	}
+
+	switch(getEmissionType()) {
+		case EmissionType::sync:
+			sendSync(payload);
+			break;
+		case EmissionType::async:
+			sendAsync(payload, lane);
+			break;
+		case EmissionType::batched: {
+			QueuedMessage queued;
+			queued.payload = payload;
+			queued.lane = lane;
+			sendBatched(std::move(queued));
+		} break;
+	}
+}
+
+
+void BaseSocket::sendRaw(const char * data, const std::size_t &size, const std::function<void()> &onSent) {
+	sendRaw(std::make_shared<const std::string>(data, size), onSent);
+}
+
+void BaseSocket::sendRaw(const std::shared_ptr<const std::string> &data, const std::function<void()> &onSent) {
+	std::shared_ptr<SharedPayload> payload = makeRawPayload(data, _format);
+
+	if(onSent)
+		payload->completion = std::shared_ptr<void>(nullptr, [onSent] (void *) { onSent(); });
+
+	send(payload);
+}
+
+std::shared_ptr<SharedPayload> BaseSocket::makeRawPayload(const std::shared_ptr<const std::string> &data, const SocketFormat &format) {
+	std::shared_ptr<SharedPayload> payload = std::make_shared<SharedPayload>();
+	payload->body = data;
+
+	switch(format) {
+		case SocketFormat::protobuf:
+			break;
+
+		case SocketFormat::protobufFramed: {
+			// Size prefix
+			uint8_t header[5];
+			uint8_t * headerEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)data->size(), header);
+			payload->data.assign(reinterpret_cast<char *>(header), headerEnd - header);
+		} break;
+
+		case SocketFormat::json:
+		case SocketFormat::ndjson:
+			payload->trailer = "\n";
 			break;
+
+		case SocketFormat::compressed: {
+			// Uncompressed frame holding the size prefixed message
+			const uint32_t size = (uint32_t)data->size();
+			Compressor::appendUncompressedHeader(protobuf::io::CodedOutputStream::VarintSize32(size) + size, payload->data);
+
+			uint8_t header[5];
+			uint8_t * headerEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray(size, header);
+			payload->data.append(reinterpret_cast<char *>(header), headerEnd - header);
+		} break;
 	}
+
+	return payload;
 }
 
 
@@ -117,15 +503,23 @@ void BaseSocket::onOpenedFromRemote(const Endpoint::Type &remoteType) {
 	_remote = Endpoint(_socket.remote_endpoint());
 	_remote.type = remoteType;
 
+	_lastReceiveTime = _lastSendTime = ClockEstimator::now();
+
 	_status = SocketStatus::ready;
 
 	LOG_INFO("Connected the " + _remote.type + " server to client on " + _remote.uri());
 
 	prepareReceive();
 
+	if(_format == compressed)
+		sendCompressionHello();
+
 	if(canPing())
 		ping(this);
 
+	scheduleHeartbeat();
+	startFailureDetection();
+
 	if(delegate)
 		delegate->socketDidOpen(this);
 }
@@ -139,119 +533,727 @@ void BaseSocket::onError() {
 void BaseSocket::sendSync(const google::protobuf::Message * message) {
 	_sendSyncMutex.lock();
 
-	// Send the message to the output buffer (through the outputStream)
-	formatMessageToStream(message, _outputStream);
+	// Serialize the message in place, in the reused output buffer
+	_sendSyncData.clear();
+	formatMessageToString(message, _sendSyncData);
 
 	boost::system::error_code error;
-	startTimer();
+	const asio::const_buffer buffer = asio::buffer(_sendSyncData);
+	writeSync(&buffer, 1, error);
 
-	// Send the datagram
-	_socket.send(_outputBuffer.data(), boost::asio::socket_base::message_flags(), error);
-
-	endTimer();
+	_sendSyncMutex.unlock();
 
 	if (error) {
 		LOG_ERROR("An error occured while sending data synchronously");
 		LOG_ERROR(error.message());
 
-		_sendSyncMutex.unlock();
 		close();
-		return;
 	}
-
-	// Clear the buffer
-	_outputBuffer.consume(_outputBuffer.size());
-
-	_sendSyncMutex.unlock();
 }
 
-void BaseSocket::sendAsync(const google::protobuf::Message * message) {
+void BaseSocket::sendAsync(const google::protobuf::Message * message, const Lane &lane) {
 	// Queue a copy of the message
-	_asyncQueue.enqueue(message);
+	QueuedMessage queued;
+	queued.message = message;
+	queued.lane = lane;
+
+	if(!enqueue(std::move(queued)))
+		return;
 
 	// Execute send
 	sendAsyncInternal();
 }
 
-void BaseSocket::sendAsyncInternal() {
-	// Are we already sending something ?
-	if(_isAsyncSending) {
-		// Yes, do nothing
+void BaseSocket::sendAsync(std::shared_ptr<const protobuf::Message> message, const Lane &lane) {
+	QueuedMessage queued;
+	queued.message = message.get();
+	queued.ownedMessage = std::move(message);
+	queued.lane = lane;
+
+	if(!enqueue(std::move(queued)))
 		return;
-	}
 
-	_isAsyncSending = true;
+	// Execute send
+	sendAsyncInternal();
+}
 
-	// Get next message to send
-	const protobuf::Message * message;
+void BaseSocket::sendSync(const std::shared_ptr<const SharedPayload> &payload) {
+	_sendSyncMutex.lock();
 
-	if(!_asyncQueue.try_dequeue(message)) {
-		_isAsyncSending = false;
-		return;
-	}
+	// Send the payload as-is
+	std::vector<asio::const_buffer> buffers;
+	payload->appendBuffers(buffers);
 
-	// Default output buffer is not used for async call and must be preserved valid for sync calls
-	asio::streambuf outputBuffer;
-	std::ostream outputStream(&outputBuffer);
+	boost::system::error_code error;
+	writeSync(buffers.data(), buffers.size(), error);
 
-	// Put the message in the buffer
-	formatMessageToStream(message, outputStream);
+	_sendSyncMutex.unlock();
 
-	// Send the datagram
-	_socket.async_write_some(outputBuffer.data(), [&] (const boost::system::error_code &error, std::size_t bytes_transferred) {
+	if (error) {
+		LOG_ERROR("An error occured while sending data synchronously");
+		LOG_ERROR(error.message());
 
-		// Tell the delegate the message is sent
-		if(delegate)
-			delegate->socketDidSendAsynchronously(this, message);
+		close();
+	}
+}
 
-		if(error) {
-			LOG_ERROR("An error occured while sending data asynchronously");
-			LOG_ERROR(error.message());
-			_isAsyncSending = false;
-			close();
-			return;
-		}
+void BaseSocket::sendAsync(const std::shared_ptr<const SharedPayload> &payload, const Lane &lane) {
+	QueuedMessage queued;
+	queued.payload = payload;
+	queued.lane = lane;
 
-		_isAsyncSending = false;
-		sendAsyncInternal();
-	});
+	if(!enqueue(std::move(queued)))
+		return;
+
+	// Execute send
+	sendAsyncInternal();
 }
 
-void BaseSocket::formatMessageToStream(const protobuf::Message * message, std::ostream & _outputStream) {
-	switch(_format) {
-		case SocketFormat::protobuf:
-			message->SerializeToOstream(&_outputStream);
-			break;
+void BaseSocket::writeSync(const asio::const_buffer * buffers, const std::size_t &count, boost::system::error_code &error) {
+	// Asio waits for the socket without any limit once its buffer is full. The
+	// socket is written directly instead, and waited for up to the deadline.
+	const int handle = _socket.native_handle();
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_sendTimeout);
 
-		case SocketFormat::json:
-			std::string messageString;
-			protobuf::util::MessageToJsonString(*message, &messageString);
-			_outputStream << messageString;
-			_outputStream << "\n";
-			break;
+	std::vector<iovec> &vectors = _sendSyncVectors;
+	vectors.clear();
+
+	for(std::size_t i = 0; i < count; ++i) {
+		if(buffers[i].size() > 0)
+			vectors.push_back({const_cast<void *>(buffers[i].data()), buffers[i].size()});
 	}
-}
-// MARK: - Reception
 
-void BaseSocket::prepareReceive() {
-	switch(_format) {
-		case SocketFormat::protobuf:
-			_socket.async_receive(asio::buffer(_receptionBuffer), boost::bind(&BaseSocket::handleReceive, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
-			break;
+	std::size_t first = 0;
+
+	while(first < vectors.size()) {
+		msghdr header = {};
+		header.msg_iov = vectors.data() + first;
+		header.msg_iovlen = std::min<std::size_t>(vectors.size() - first, IOV_MAX);
+
+		const ssize_t sent = ::sendmsg(handle, &header, sendFlags);
+
+		if(sent < 0) {
+			if(errno == EINTR)
+				continue;
+
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				error = boost::system::error_code(errno, asio::error::get_system_category());
+				return;
+			}
+
+			// The socket buffer is full, wait for it to make room
+			const long long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			pollfd descriptor = {handle, POLLOUT, 0};
+
+			const int ready = remaining > 0 ? ::poll(&descriptor, 1, (int)remaining) : 0;
+
+			if(ready == 0) {
+				LOG_ERROR("Socket send timeout");
+				error = asio::error::timed_out;
+				return;
+			}
+
+			if(ready < 0 && errno != EINTR) {
+				error = boost::system::error_code(errno, asio::error::get_system_category());
+				return;
+			}
+
+			continue;
+		}
+
+		// Skip what was written
+		std::size_t written = (std::size_t)sent;
+
+		while(written > 0) {
+			iovec &vector = vectors[first];
+
+			if(written < vector.iov_len) {
+				vector.iov_base = static_cast<char *>(vector.iov_base) + written;
+				vector.iov_len -= written;
+				break;
+			}
+
+			written -= vector.iov_len;
+			++first;
+		}
+	}
+}
+
+void BaseSocket::sendBatched(QueuedMessage &&queued) {
+	// Batches always measure their messages
+	const std::size_t size = queued.size = queued.payload ? queued.payload->size() : queued.message->ByteSizeLong();
+	const bool isControl = queued.lane == controlLane;
+
+	if(!enqueue(std::move(queued)))
+		return;
+
+	// Control messages are not delayed
+	if(isControl)
+		return flush();
+
+	const std::size_t batchSize = _batchSize += size;
+	const std::size_t batchCount = ++_batchCount;
+
+	if(batchSize >= _batchMaxSize || batchCount >= _batchMaxCount)
+		return flush();
+
+	// The first message of the batch starts the countdown
+	if(batchCount > 1)
+		return;
+
+	std::lock_guard<std::mutex> lock(_batchMutex);
+
+	_batchTimer.expires_from_now(boost::posix_time::microseconds(_batchDeadline));
+	_batchTimer.async_wait([&] (const boost::system::error_code &error) {
+		// Operation aborted is send if the timer is cancelled, meaning the batch is already sent
+		if(error != boost::asio::error::operation_aborted)
+			flush();
+	});
+
+	Engine::instance()->runContext();
+}
+
+void BaseSocket::flush() {
+	if(_status != SocketStatus::ready)
+		return;
+
+	// Messages queued from now on go in the next batch
+	_batchSize = 0;
+	_batchCount = 0;
+
+	_batchMutex.lock();
+	_batchTimer.cancel();
+	_batchMutex.unlock();
+
+	sendAsyncInternal();
+}
+
+void BaseSocket::sendAsyncInternal() {
+	// Are we already sending something ? If not, we are now.
+	bool isSending = false;
+	if(!_isAsyncSending.compare_exchange_strong(isSending, true)) {
+		// Yes, do nothing
+		return;
+	}
+
+	// Take everything queued, up to the batch size
+	dequeueSendingMessages(asyncBatchSize);
+
+	const std::size_t count = _sendingMessages.size();
+
+	if(count > 0) {
+		std::size_t size = 0;
+
+		for(const QueuedMessage &queued: _sendingMessages)
+			size += queued.size;
+
+		onDequeue(size, count);
+	}
+
+	if(count == 0) {
+		_isAsyncSending = false;
+
+		// A message may have been queued while we were releasing the flag
+		if(hasQueuedMessages())
+			sendAsyncInternal();
+
+		return;
+	}
+
+	// Format every message in its own buffer. Buffers are kept between batches
+	// to reuse their memory.
+	if(_sendingData.size() < count)
+		_sendingData.resize(count);
+
+	_sendingBuffers.clear();
+
+	std::size_t dataCount = 0;
+
+	// With the `compressed` format, consecutive messages using the same
+	// dictionary are compressed together in a single frame
+	const CompressionDictionary * dictionary = nullptr;
+
+	auto flushCompressedFrame = [&] {
+		if(_compressionInput.empty())
+			return;
+
+		std::string &frame = _sendingData[dataCount++];
+		frame.clear();
+		appendCompressedFrame(dictionary, frame);
+		_sendingBuffers.push_back(asio::buffer(frame));
+	};
+
+	for(std::size_t i = 0; i < count; ++i) {
+		// Payloads are already formatted, send them in place
+		if(_sendingMessages[i].payload) {
+			flushCompressedFrame();
+			_sendingMessages[i].payload->appendBuffers(_sendingBuffers);
+			continue;
+		}
+
+		if(_format == compressed) {
+			const CompressionDictionary * messageDictionary = _compressor->remoteDictionary(CompressionDictionaries::typeOf(_sendingMessages[i].message));
+
+			if(messageDictionary != dictionary)
+				flushCompressedFrame();
+
+			dictionary = messageDictionary;
+			formatMessage(_sendingMessages[i].message, protobufFramed, _compressionInput);
+			continue;
+		}
+
+		std::string &data = _sendingData[dataCount++];
+		data.clear();
+		formatMessageToString(_sendingMessages[i].message, data);
+		_sendingBuffers.push_back(asio::buffer(data));
+	}
+
+	flushCompressedFrame();
+
+	_lastSendTime = ClockEstimator::now();
+
+	// Send the whole batch with gather writes, until everything is written.
+	// Every partial write is a progress of the emission.
+	asio::async_write(_socket, _sendingBuffers, [&] (const boost::system::error_code &error, std::size_t transferred) -> std::size_t {
+		if(!error)
+			_lastSendTime = ClockEstimator::now();
+
+		return asio::transfer_all()(error, transferred);
+	}, [&] (const boost::system::error_code &error, std::size_t) {
+
+		// Tell the delegate the messages it owns are sent. Owned messages and payloads are released.
+		if(delegate) {
+			for(const QueuedMessage &queued: _sendingMessages) {
+				if(queued.message && !queued.ownedMessage)
+					delegate->socketDidSendAsynchronously(this, queued.message);
+			}
+		}
+
+		_sendingMessages.clear();
+
+		if(error) {
+			LOG_ERROR("An error occured while sending data asynchronously");
+			LOG_ERROR(error.message());
+			_isAsyncSending = false;
+			close();
+			return;
+		}
+
+		_isAsyncSending = false;
+		sendAsyncInternal();
+	});
+
+	Engine::instance()->runContext();
+}
+
+bool BaseSocket::enqueue(QueuedMessage &&queued) {
+	// Messages are only measured when needed
+	if(queued.size == 0)
+		queued.size = queued.payload ? queued.payload->size() : (_queueMaxSize > 0 ? queued.message->ByteSizeLong() : 0);
+
+	uint64_t key = 0;
+	const bool isConflated = _isConflating && queued.message && queued.lane != controlLane && _conflationKey && _conflationKey(queued.message, key);
+
+	// A newer value replaces the one still waiting in the queue, keeping its place
+	if(isConflated && storeConflated(key, queued, false))
+		return true;
+
+	if(queued.lane != controlLane && !canQueue(queued.size)) {
+		switch(_overflowPolicy) {
+			case OverflowPolicy::block: {
+				// The network thread empties the queue, it cannot wait for it
+				if(Engine::instance()->isContextThread())
+					break;
+
+				std::unique_lock<std::mutex> lock(_overflowMutex);
+
+				++_blockedSenders;
+				_overflowCondition.wait(lock, [&] {
+					return _status != SocketStatus::ready || canQueue(queued.size);
+				});
+				--_blockedSenders;
+
+				if(_status == SocketStatus::ready)
+					break;
+
+				// The socket closed while waiting
+				notifyDropped(queued);
+			} return false;
+
+			case OverflowPolicy::dropNewest:
+				++_droppedCount;
+				notifyDropped(queued);
+				return false;
+
+			case OverflowPolicy::dropOldest: {
+				QueuedMessage oldest;
+
+				// Lower priority lanes are dropped first, control messages are kept
+				for(unsigned int lane = laneCount - 1; lane > controlLane && !canQueue(queued.size); --lane) {
+					while(!canQueue(queued.size) && _asyncQueues[lane].try_dequeue(oldest)) {
+						if(oldest.isConflated && !resolveConflated(oldest))
+							oldest = QueuedMessage();
+
+						onDequeue(oldest.size, 1);
+
+						++_droppedCount;
+						notifyDropped(oldest);
+
+						oldest = QueuedMessage();
+					}
+				}
+			} break;
+
+			case OverflowPolicy::closeConnection:
+				LOG_ERROR("Socket queue is full. Closing socket");
+
+				++_droppedCount;
+				notifyDropped(queued);
+
+				close();
+				return false;
+		}
+	}
+
+	const std::size_t size = queued.size;
+
+	if(isConflated) {
+		QueuedMessage placeholder;
+		placeholder.lane = queued.lane;
+		placeholder.isConflated = true;
+		placeholder.key = key;
+
+		// Another value of the key may have been queued meanwhile
+		if(storeConflated(key, queued, true))
+			return true;
+
+		// The lane holds the placeholder, accounted with the message size
+		queued = std::move(placeholder);
+	}
+
+	_asyncQueues[queued.lane].enqueue(std::move(queued));
+
+	_queueSize += size;
+	++_queueCount;
+
+	if(!_isQueueFilled && isQueueAbove(_queueHighWatermark)) {
+		bool isFilled = false;
+
+		if(_isQueueFilled.compare_exchange_strong(isFilled, true) && delegate)
+			delegate->socketDidReachHighWatermark(this);
+	}
+
+	return true;
+}
+
+bool BaseSocket::canQueue(const std::size_t &size) const {
+	// An empty queue accepts any message, whatever its size
+	if(_queueCount == 0)
+		return true;
+
+	if(_queueMaxSize > 0 && _queueSize + size > _queueMaxSize)
+		return false;
+
+	return _queueMaxCount == 0 || _queueCount < _queueMaxCount;
+}
+
+bool BaseSocket::isQueueAbove(const float &watermark) const {
+	if(_queueMaxSize > 0 && _queueSize >= _queueMaxSize * watermark)
+		return true;
+
+	return _queueMaxCount > 0 && _queueCount >= _queueMaxCount * watermark;
+}
+
+void BaseSocket::onDequeue(const std::size_t &size, const std::size_t &count) {
+	_queueSize -= size;
+	_queueCount -= count;
+
+	if(_isQueueFilled && !isQueueAbove(_queueLowWatermark)) {
+		bool isFilled = true;
+
+		if(_isQueueFilled.compare_exchange_strong(isFilled, false) && delegate)
+			delegate->socketDidReachLowWatermark(this);
+	}
+
+	if(_blockedSenders == 0)
+		return;
+
+	// Wake up the senders waiting for room in the queue
+	_overflowMutex.lock();
+	_overflowMutex.unlock();
+
+	_overflowCondition.notify_all();
+}
+
+bool BaseSocket::defaultConflationKey(const protobuf::Message * message, uint64_t &key) {
+	if(message->GetDescriptor() != messages::Datagram::descriptor())
+		return false;
+
+	const messages::Datagram * datagram = static_cast<const messages::Datagram *>(message);
+
+	// Every remote call is waited for
+	if(datagram->request_id() != 0 || datagram->response_id() != 0)
+		return false;
+
+	key = datagram->type();
+
+	// System datagrams all matter
+	return key >= 10;
+}
+
+bool BaseSocket::storeConflated(const uint64_t &key, QueuedMessage &queued, const bool &canInsert) {
+	const std::size_t size = queued.size;
+	QueuedMessage replaced;
+
+	{
+		std::lock_guard<std::mutex> lock(_conflationMutex);
+		auto it = _conflatedMessages.find(key);
+
+		if(it == _conflatedMessages.end()) {
+			if(canInsert)
+				_conflatedMessages.emplace(key, std::move(queued));
+
+			return false;
+		}
+
+		replaced = std::move(it->second);
+		it->second = std::move(queued);
+	}
+
+	_queueSize += size;
+	_queueSize -= replaced.size;
+
+	++_conflatedCount;
+	notifyDropped(replaced);
+
+	return true;
+}
+
+bool BaseSocket::resolveConflated(QueuedMessage &queued) {
+	std::lock_guard<std::mutex> lock(_conflationMutex);
+	auto it = _conflatedMessages.find(queued.key);
+
+	if(it == _conflatedMessages.end())
+		return false;
+
+	queued = std::move(it->second);
+	_conflatedMessages.erase(it);
+
+	return true;
+}
+
+void BaseSocket::notifyDropped(const QueuedMessage &queued) {
+	if(delegate && queued.message && !queued.ownedMessage)
+		delegate->socketDidDropMessage(this, queued.message);
+}
+
+void BaseSocket::dequeueSendingMessages(const std::size_t &maxCount) {
+	_sendingMessages.resize(maxCount);
+
+	// Control messages always go first
+	std::size_t count = _asyncQueues[controlLane].try_dequeue_bulk(_sendingMessages.begin(), maxCount);
+
+	if(_laneScheduling == LaneScheduling::strictPriority) {
+		for(unsigned int lane = controlLane + 1; lane < laneCount && count < maxCount; ++lane)
+			count += _asyncQueues[lane].try_dequeue_bulk(_sendingMessages.begin() + count, maxCount - count);
+
+		// Conflated messages are taken in place of their placeholders
+		std::size_t resolvedCount = 0;
+
+		for(std::size_t i = 0; i < count; ++i) {
+			if(_sendingMessages[i].isConflated && !resolveConflated(_sendingMessages[i])) {
+				onDequeue(0, 1);
+				continue;
+			}
+
+			if(resolvedCount != i)
+				_sendingMessages[resolvedCount] = std::move(_sendingMessages[i]);
+
+			++resolvedCount;
+		}
+
+		_sendingMessages.resize(resolvedCount);
+		return;
+	}
+
+	// Deficit round robin: on its turn, a lane sends messages as long as its
+	// deficit is positive. The last message may overdraw it, and the overdraft
+	// is paid on the next turn. Empty lanes do not keep their deficit.
+	unsigned int emptyTurns = 0;
+
+	while(count < maxCount && emptyTurns < laneCount) {
+		QueuedMessage &queued = _sendingMessages[count];
+
+		if(_laneDeficits[_fairLane] > 0 && _asyncQueues[_fairLane].try_dequeue(queued)) {
+			emptyTurns = 0;
+
+			if(queued.isConflated && !resolveConflated(queued)) {
+				onDequeue(0, 1);
+				continue;
+			}
+
+			_laneDeficits[_fairLane] -= queued.size > 0 ? queued.size : (queued.payload ? queued.payload->size() : queued.message->ByteSizeLong());
+			++count;
+			continue;
+		}
+
+		// Either the lane is empty, or its turn is over
+		if(_laneDeficits[_fairLane] > 0) {
+			_laneDeficits[_fairLane] = 0;
+			++emptyTurns;
+		}
+
+		_fairLane = _fairLane + 1 < laneCount ? _fairLane + 1 : controlLane + 1;
+		_laneDeficits[_fairLane] += (long long)_laneWeights[_fairLane] * laneQuantum;
+	}
+
+	_sendingMessages.resize(count);
+}
+
+bool BaseSocket::hasQueuedMessages() const {
+	for(const moodycamel::ConcurrentQueue<QueuedMessage> &queue: _asyncQueues) {
+		if(queue.size_approx() > 0)
+			return true;
+	}
+
+	return false;
+}
+
+void BaseSocket::dropQueuedMessages() {
+	QueuedMessage queued;
+
+	for(moodycamel::ConcurrentQueue<QueuedMessage> &queue: _asyncQueues) {
+		while(queue.try_dequeue(queued)) {
+			if(queued.isConflated && !resolveConflated(queued))
+				queued = QueuedMessage();
+
+			onDequeue(queued.size, 1);
+			notifyDropped(queued);
+
+			queued = QueuedMessage();
+		}
+	}
+
+	// Senders blocked on a full queue give up once the socket is closed
+	_overflowMutex.lock();
+	_overflowMutex.unlock();
+
+	_overflowCondition.notify_all();
+}
+
+void BaseSocket::sendCompressionHello() {
+	std::shared_ptr<SharedPayload> hello = std::make_shared<SharedPayload>();
+	Compressor::appendHello(hello->data);
+
+	send(hello);
+}
+
+void BaseSocket::appendCompressedFrame(const CompressionDictionary * dictionary, std::string &output) {
+	_compressor->appendFrame(_compressionInput.data(), _compressionInput.size(), _compressionCodec, _compressionLevel, _compressionThreshold, dictionary, output);
+	_compressionInput.clear();
+}
+
+void BaseSocket::formatMessageToString(const protobuf::Message * message, std::string & output) {
+	if(_format != compressed)
+		return formatMessage(message, _format, output);
+
+	// Compress using the settings of the socket
+	formatMessage(message, protobufFramed, _compressionInput);
+	appendCompressedFrame(_compressor->remoteDictionary(CompressionDictionaries::typeOf(message)), output);
+}
+
+void BaseSocket::formatMessage(const protobuf::Message * message, const SocketFormat &format, std::string &output) {
+	switch(format) {
+		case SocketFormat::protobuf: {
+			// The message is measured once, and serialized in place
+			const std::size_t messageSize = message->ByteSizeLong();
+			const std::size_t offset = output.size();
+
+			output.resize(offset + messageSize);
+			message->SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(&output[offset]));
+		} break;
+
+		case SocketFormat::protobufFramed: {
+			// Size prefix, followed by the message serialized in place
+			const std::size_t messageSize = message->ByteSizeLong();
+			const std::size_t headerSize = protobuf::io::CodedOutputStream::VarintSize32((uint32_t)messageSize);
+			const std::size_t offset = output.size();
+
+			output.resize(offset + headerSize + messageSize);
+
+			uint8_t * data = reinterpret_cast<uint8_t *>(&output[offset]);
+			data = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)messageSize, data);
+			message->SerializeWithCachedSizesToArray(data);
+		} break;
 
 		case SocketFormat::json:
-			boost::asio::async_read_until(_socket, _receptionStreamBuffer, "\r\n\r\n", boost::bind(&BaseSocket::handleReceive, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+		case SocketFormat::ndjson:
+			// Messages are printed on a single line
+			JSONCodec::instance()->encode(*message, output);
+			output += "\n";
 			break;
+
+		case SocketFormat::compressed: {
+			// The message may be sent to several remotes, it is compressed
+			// without dictionary using the default settings
+			static thread_local Compressor compressor;
+			std::string messages;
+
+			formatMessage(message, protobufFramed, messages);
+			compressor.appendFrame(messages.data(), messages.size(), zstd, 3, Compressor::defaultThreshold, nullptr, output);
+		} break;
 	}
+}
+
+// MARK: - Reception
+
+void BaseSocket::prepareReceive() {
+	// Wait for data without holding a reception buffer. A buffer is only
+	// borrowed from the pool once there is something to read.
+	_socket.async_wait(asio::ip::tcp::socket::wait_read, boost::bind(&BaseSocket::handleReadable, this, boost::asio::placeholders::error));
 
 	Engine::instance()->runContext();
 }
 
+void BaseSocket::handleReadable(const boost::system::error_code &error) {
+	if(error)
+		return handleReceive(error, 0);
+
+	_receiveMutex.lock();
+
+	// Make room for everything that is waiting on the socket
+	boost::system::error_code receiveError;
+	std::size_t available = _socket.available(receiveError);
+	std::size_t capacity = _receptionBuffer.size() + std::max<std::size_t>(available, 1);
+
+	_receptionBuffer.reserve(std::min(capacity, BufferPool::instance()->getMaximumBufferSize()));
+
+	std::size_t bytes_transferred = 0;
+
+	if(!receiveError)
+		bytes_transferred = _socket.receive(_receptionBuffer.freeSegments(), 0, receiveError);
+
+	_receiveMutex.unlock();
+
+	handleReceive(receiveError, bytes_transferred);
+}
+
 void BaseSocket::handleReceive(const boost::system::error_code &error, std::size_t bytes_transferred) {
 
+	// The socket was closed, and may already be released. Its buffers are
+	// released with it.
+	if(error == asio::error::operation_aborted)
+		return;
+
 	// Check for any error during reception
 	if(error) {
-		if(error == asio::error::operation_aborted || error == asio::error::eof)
+		_receiveMutex.lock();
+		_receptionBuffer.clear();
+		_receptionScanOffset = 0;
+		_receptionBuffer.release();
+		_receiveMutex.unlock();
+
+		if(error == asio::error::eof)
 			return;
 
 		LOG_ERROR("Error while receiving data. Closing socket");
@@ -261,33 +1263,233 @@ void BaseSocket::handleReceive(const boost::system::error_code &error, std::size
 		return;
 	}
 
-	_receiveMutex.lock();
+	// Anything received tells the remote is still there
+	const int64_t now = ClockEstimator::now();
+	_lastReceiveTime = now;
 
-	// Check we haven't reached the buffer size
-	if(bytes_transferred >= RECEPTION_BUFFER_SIZE) {
-		LOG_WARN("TCP Connection reception buffer sized reach. If the message was larger than the buffer size, ignoring packet");
+	if(_detectFailures)
+		_failureDetector.heartbeat(now);
 
-		_receiveMutex.unlock();
-		return prepareReceive();
-	}
+	_receiveMutex.lock();
+
+	_receptionBuffer.commit(bytes_transferred);
 
-	// Decode the message using the proper format
-	protobuf::Message * message = nullptr;
+	bool isValid = true;
 
 	switch(_format) {
 		case protobuf:
-			message = decodeMessageFromBuffer(_receptionBuffer, bytes_transferred);
+			decodeMessage();
 			break;
 		case json:
-			message = decodeMessageFromBuffer(&_receptionStreamBuffer, bytes_transferred);
+			isValid = decodeJSONMessages("\r\n\r\n", 4);
+			break;
+		case ndjson:
+			isValid = decodeJSONMessages("\n", 1);
+			break;
+		case protobufFramed:
+		case compressed:
+			// Framed messages are decoded independently of the reception boundaries
+			isValid = decodeFrames();
+			break;
 	}
 
-	// Pass along the received datagram
-	onReceive(message);
+	// Give back the buffer to the pool as soon as there is nothing left in it
+	if(_receptionBuffer.empty())
+		_receptionScanOffset = 0;
+
+	_receptionBuffer.release();
+
+	// All the messages of this reception have been consumed
+	if(_receptionArena)
+		_receptionArena->Reset();
 
 	_receiveMutex.unlock();
 
+	if(!isValid)
+		return;
+
 	return prepareReceive();
 }
 
+void BaseSocket::decodeMessage() {
+	// Check we haven't reached the buffer size
+	boost::system::error_code error;
+	if(_receptionBuffer.full() && _socket.available(error) > 0) {
+		LOG_WARN("TCP Connection reception buffer sized reach. If the message was larger than the buffer size, ignoring packet");
+
+		_receptionBuffer.clear();
+		return;
+	}
+
+	// Decode the message in place
+	RingBuffer::InputStream stream(_receptionBuffer, 0, _receptionBuffer.size());
+	protobuf::Message * message = decodeMessageFromBuffer(&stream);
+
+	_receptionBuffer.clear();
+
+	// Pass along the received datagram
+	onReceive(message);
+}
+
+bool BaseSocket::decodeJSONMessages(const char * delimiter, const std::size_t &delimiterSize) {
+	std::string scratch;
+
+	while(_status == SocketStatus::ready) {
+		// Do not look again in bytes already searched on a previous reception
+		std::size_t position = delimiterSize == 1
+			? _receptionBuffer.findByte(delimiter[0], _receptionScanOffset)
+			: _receptionBuffer.find(delimiter, delimiterSize, _receptionScanOffset);
+
+		if(position == RingBuffer::npos) {
+			// The end of the buffer may hold the start of a delimiter
+			const std::size_t size = _receptionBuffer.size();
+			_receptionScanOffset = size >= delimiterSize ? size - delimiterSize + 1 : 0;
+			break;
+		}
+
+		_receptionScanOffset = 0;
+
+		// Ignore the carriage return of CRLF line endings, and skip empty lines
+		std::size_t messageSize = position;
+		char lastChar = 0;
+
+		if(messageSize > 0 && _receptionBuffer.peek(messageSize - 1, &lastChar, 1) && lastChar == '\r')
+			--messageSize;
+
+		if(messageSize == 0) {
+			_receptionBuffer.consume(position + delimiterSize);
+			continue;
+		}
+
+		// Parse the message in place, unless it wraps around the end of the buffer
+		const char * messageText = _receptionBuffer.contiguous(0, messageSize, scratch);
+
+		protobuf::Message * message = decodeMessageFromJSON(messageText, messageSize);
+
+		_receptionBuffer.consume(position + delimiterSize);
+
+		onReceive(message);
+	}
+
+	// What is left has no delimiter yet, the remote cannot make it larger than a frame
+	if(_receptionBuffer.size() > _maxFrameSize || (_receptionBuffer.full() && _receptionBuffer.capacity() >= BufferPool::instance()->getMaximumBufferSize())) {
+		LOG_ERROR("Received an oversized JSON message. Closing socket");
+		_receptionBuffer.clear();
+		close();
+		return false;
+	}
+
+	return _status == SocketStatus::ready;
+}
+
+bool BaseSocket::decodeFrames() {
+	std::string scratch;
+
+	while(!_receptionBuffer.empty() && _status == SocketStatus::ready) {
+		std::size_t frameSize, headerSize;
+
+		// The prefix may wrap around the end of the buffer
+		char header[5];
+		std::size_t headerBytes = _receptionBuffer.peek(0, header, sizeof(header));
+
+		int headerStatus = readFrameHeader(header, headerBytes, frameSize, headerSize);
+
+		if(headerStatus == 0)
+			break; // Incomplete prefix, wait for more data
+
+		// The remote cannot make the socket reserve more than a frame
+		if(headerStatus < 0 || frameSize > _maxFrameSize || headerSize + frameSize > BufferPool::instance()->getMaximumBufferSize()) {
+			LOG_ERROR("Received an invalid or oversized frame. Closing socket");
+			_receptionBuffer.clear();
+			close();
+			return false;
+		}
+
+		if(_receptionBuffer.size() < headerSize + frameSize) {
+			// Incomplete body, grow the buffer to hold the whole frame and wait for more data
+			_receptionBuffer.reserve(headerSize + frameSize);
+			break;
+		}
+
+		if(_format == compressed) {
+			// The frame is decompressed, or read in place, then consumed
+			const char * frame = _receptionBuffer.contiguous(headerSize, frameSize, scratch);
+			const bool isValid = decodeCompressedFrame(frame, frameSize);
+
+			_receptionBuffer.consume(headerSize + frameSize);
+
+			if(isValid)
+				continue;
+
+			LOG_ERROR("Received an invalid compressed frame. Closing socket");
+			_receptionBuffer.clear();
+			close();
+			return false;
+		}
+
+		// Parse the message in place, and pass it along
+		RingBuffer::InputStream stream(_receptionBuffer, headerSize, frameSize);
+		protobuf::Message * message = decodeMessageFromBuffer(&stream);
+
+		_receptionBuffer.consume(headerSize + frameSize);
+
+		onReceive(message);
+	}
+
+	return _status == SocketStatus::ready;
+}
+
+bool BaseSocket::decodeCompressedFrame(const char * frame, const std::size_t &size) {
+	const char * messages;
+	std::size_t messagesSize;
+
+	if(!_compressor->readFrame(frame, size, _maxFrameSize, messages, messagesSize))
+		return false;
+
+	// The frame holds framed messages
+	std::size_t offset = 0;
+	bool isValid = true;
+
+	while(offset < messagesSize && _status == SocketStatus::ready) {
+		std::size_t messageSize, headerSize;
+
+		if(readFrameHeader(messages + offset, messagesSize - offset, messageSize, headerSize) != 1 || messageSize > _maxFrameSize || headerSize + messageSize > messagesSize - offset) {
+			isValid = false;
+			break;
+		}
+
+		protobuf::io::ArrayInputStream stream(messages + offset + headerSize, (int)messageSize);
+		protobuf::Message * message = decodeMessageFromBuffer(&stream);
+
+		offset += headerSize + messageSize;
+
+		onReceive(message);
+	}
+
+	// A large frame does not keep its memory for the rest of the connection
+	_compressor->releaseFrame();
+
+	return isValid;
+}
+
+int BaseSocket::readFrameHeader(const char * buffer, const std::size_t &size, std::size_t &frameSize, std::size_t &headerSize) {
+	frameSize = 0;
+
+	// A varint32 spans at most 5 bytes, 7 bits per byte
+	for(headerSize = 0; headerSize < 5; ++headerSize) {
+		if(headerSize >= size)
+			return 0;
+
+		const uint8_t byte = static_cast<uint8_t>(buffer[headerSize]);
+		frameSize |= static_cast<std::size_t>(byte & 0x7F) << (7 * headerSize);
+
+		if((byte & 0x80) == 0) {
+			++headerSize;
+			return 1;
+		}
+	}
+
+	return -1;
+}
+
 } /* ::network */
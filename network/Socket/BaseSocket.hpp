@@ -8,27 +8,44 @@
 #ifndef BaseSocket_hpp
 #define BaseSocket_hpp
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/uio.h>
 
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
 #include <boost/bind.hpp>
 
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/message.h>
+#include <google/protobuf/util/delimited_message_util.h>
 #include <google/protobuf/util/json_util.h>
 
 #include "../third-parties/concurrentqueue.h"
 
 #include <common/log.hpp>
 
+#include "ClockEstimator.hpp"
+#include "Compressor.hpp"
+#include "FailureDetector.hpp"
+#include "JSONCodec.hpp"
+#include "RingBuffer.hpp"
+#include "RTTStatistics.hpp"
+#include "SharedPayload.hpp"
 #include "SocketStatus.hpp"
 #include "../Endpoint.hpp"
 #include "../Engine.hpp"
 
-#define RECEPTION_BUFFER_SIZE 128000
-
 namespace asio = boost::asio;
 namespace protobuf = google::protobuf;
 
@@ -43,7 +60,11 @@ class SocketDelegate;
 class BaseSocket {
 public:
 
-	BaseSocket(): _outputStream(&_outputBuffer) {}
+	BaseSocket() {}
+
+	/// Gives the conflation key of the given message. Returns false if the
+	/// message is not to be conflated.
+	using ConflationKey = std::function<bool(const protobuf::Message *, uint64_t &key)>;
 
 	SocketDelegate * delegate;
 
@@ -55,15 +76,34 @@ public:
 	/// Connects the socket to the given endpoint
 	void connectTo(const Endpoint &remote);
 
+	/// Connects the socket to the given ip and port asynchronously
+	void asyncConnectTo(const std::string &ip, const NetworkPort &port, const unsigned int &timeout = connectTimeout);
+
+	/// Connects the socket to the given endpoint asynchronously.
+	///
+	/// This method returns right away. `SocketDelegate::socketDidOpen` is
+	/// called once the socket is connected, and `SocketDelegate::socketDidFailToConnect`
+	/// if the connection failed or did not complete in time.
+	/// @param remote The endpoint to connect to
+	/// @param timeout Delay in milliseconds before giving up
+	void asyncConnectTo(const Endpoint &remote, const unsigned int &timeout = connectTimeout);
+
 	/// Terminates the connection, closing the socket.
 	///
 	/// This method may be called by the socket on itself if certain conditions are
 	/// met, such as when the remote closes the socket on its side.
-	/// Calls to this method triggers the callback `onClose`.
+	/// Calls to this method triggers the callback `onClose`. An asynchronous
+	/// connection still in progress is aborted instead, and reported as failed.
 	void close();
 
 	virtual ~BaseSocket();
 
+	/// Closes the given socket, and deletes it once the handlers of its
+	/// aborted operations have run. Sockets with operations in progress, or
+	/// released from a delegate callback, must be released this way.
+	/// @param socket The socket to release
+	static void release(BaseSocket * socket);
+
 
 	// MARK: - Exchanges
 
@@ -74,7 +114,76 @@ public:
 	///	of the emission
 	///
 	/// @param message The message to send
-	void send(const protobuf::Message * message);
+	/// @param lane The priority lane of the message, when sent asynchronously
+	void send(const protobuf::Message * message, const Lane &lane = normalLane);
+
+	/// Sends the given message to the connected remote, taking ownership of it.
+	///
+	/// The message is released by the socket once sent, or when the socket
+	/// closes if it is still queued. `socketDidSendAsynchronously` is not called
+	/// for owned messages. A `std::unique_ptr` can be given as well.
+	///
+	/// @param message The message to send
+	/// @param lane The priority lane of the message, when sent asynchronously
+	void send(std::shared_ptr<const protobuf::Message> message, const Lane &lane = normalLane);
+
+	/// Sends the given message to the connected remote. The message is moved,
+	/// or copied, in a message owned by the socket.
+	///
+	/// @param message The message to send
+	/// @param lane The priority lane of the message, when sent asynchronously
+	template<class MessageType, typename = typename std::enable_if<std::is_base_of<protobuf::Message, typename std::decay<MessageType>::type>::value>::type>
+	inline void send(MessageType &&message, const Lane &lane = normalLane) {
+		using Type = typename std::decay<MessageType>::type;
+		send(std::shared_ptr<const protobuf::Message>(new Type(std::forward<MessageType>(message))), lane);
+	}
+
+	/// Sends the given pre-formatted payload to the connected remote.
+	///
+	/// The payload must be in the format of the socket. It is sent as-is and
+	/// released once sent.
+	///
+	/// @param payload The payload to send
+	/// @param lane The priority lane of the payload, when sent asynchronously
+	void send(const std::shared_ptr<const SharedPayload> &payload, const Lane &lane = normalLane);
+
+	/// Sends the given serialized message to the connected remote, without
+	/// parsing it. The bytes are copied.
+	///
+	/// The bytes must be a message serialized in the socket format, without
+	/// any framing. The socket adds the framing required by its format.
+	///
+	/// @param data The serialized message
+	/// @param size The size of the serialized message
+	/// @param onSent Called once the socket is done with the bytes, sent or dropped
+	void sendRaw(const char * data, const std::size_t &size, const std::function<void()> &onSent = nullptr);
+
+	/// Sends the given serialized message to the connected remote, without
+	/// parsing nor copying it.
+	///
+	/// The bytes must be a message serialized in the socket format, without
+	/// any framing. The socket adds the framing required by its format. They
+	/// must not be modified until `onSent` is called.
+	///
+	/// @param data The serialized message
+	/// @param onSent Called once the socket is done with the bytes, sent or dropped
+	void sendRaw(const std::shared_ptr<const std::string> &data, const std::function<void()> &onSent = nullptr);
+
+	/// Builds a payload sending the given serialized message in the given
+	/// exchange format, adding the framing it requires. The message bytes are not copied.
+	/// @param data The serialized message
+	/// @param format The exchange format to use
+	static std::shared_ptr<SharedPayload> makeRawPayload(const std::shared_ptr<const std::string> &data, const SocketFormat &format);
+
+	/// Sends right away the messages waiting in the current batch. Only
+	/// relevant with the `batched` emission type.
+	void flush();
+
+	/// Formats the given message in the given exchange format, and append it to the given string
+	/// @param message The message to format
+	/// @param format The exchange format to use
+	/// @param output The receiving string
+	static void formatMessage(const protobuf::Message * message, const SocketFormat &format, std::string &output);
 
 	// MARK: - Getters & Setters
 
@@ -84,6 +193,13 @@ public:
 	/// Gives the status of the socket
 	inline SocketStatus getStatus() const { return _status; }
 
+	/// Gives the delay in milliseconds after which a synchronous send fails
+	inline unsigned int getSendTimeout() const { return _sendTimeout; }
+
+	/// Sets the delay after which a synchronous send fails, closing the socket
+	/// @param timeout A delay in milliseconds
+	inline void setSendTimeout(const unsigned int &timeout) { _sendTimeout = timeout; }
+
 	/// Gives the `EmissionType` of the socket
 	inline EmissionType getEmissionType() const { return _emissionType; }
 
@@ -91,9 +207,174 @@ public:
 	/// @param et An emission type
 	inline void setEmissionType(const EmissionType &et) { _emissionType = et; }
 
+	/// Sets the limits of the batches of the `batched` emission type. A batch
+	/// is sent as soon as one of its limits is reached.
+	/// @param maxSize Size in bytes of the waiting messages
+	/// @param maxCount Number of waiting messages
+	/// @param deadline Delay in microseconds after the first message of the batch
+	inline void setBatching(const std::size_t &maxSize, const std::size_t &maxCount, const unsigned int &deadline) {
+		_batchMaxSize = maxSize;
+		_batchMaxCount = maxCount;
+		_batchDeadline = deadline;
+	}
+
+	/// Sets the limits of the queue of messages waiting to be sent. Once the
+	/// queue is full, the overflow policy of the socket is applied to the
+	/// messages sent. A message is always accepted by an empty queue.
+	/// @param maxSize Size in bytes of the waiting messages, 0 for no limit
+	/// @param maxCount Number of waiting messages, 0 for no limit
+	inline void setQueueLimits(const std::size_t &maxSize, const std::size_t &maxCount) {
+		_queueMaxSize = maxSize;
+		_queueMaxCount = maxCount;
+	}
+
+	/// Sets the watermarks of the queue, as parts of its limits. The delegate
+	/// is told when the queue goes above the high watermark, and when it goes
+	/// back under the low watermark.
+	/// @param high The high watermark, between 0 and 1
+	/// @param low The low watermark, between 0 and `high`
+	inline void setQueueWatermarks(const float &high, const float &low) {
+		_queueHighWatermark = high;
+		_queueLowWatermark = low;
+	}
+
+	/// Gives how the lanes share the emission
+	inline LaneScheduling getLaneScheduling() const { return _laneScheduling; }
+
+	/// Sets how the lanes share the emission
+	/// @param scheduling A lane scheduling
+	inline void setLaneScheduling(const LaneScheduling &scheduling) { _laneScheduling = scheduling; }
+
+	/// Sets the weight of a lane, used with the `weightedFair` scheduling.
+	/// The control lane has no weight, it is always sent first.
+	/// @param lane A lane
+	/// @param weight The weight of the lane, at least 1
+	inline void setLaneWeight(const Lane &lane, const unsigned int &weight) {
+		_laneWeights[lane] = std::max(weight, 1u);
+	}
+
+	/// Tell if the socket conflates the messages it sends
+	inline bool isConflating() const { return _isConflating; }
+
+	/// Enables or disables the conflation of the messages sent asynchronously.
+	///
+	/// When enabled, a message whose key matches the one of a message still
+	/// waiting in the queue replaces it, and is sent in its place. Only the
+	/// latest value of each key is sent, and the queue holds at most one
+	/// message per key. Replaced messages are released, or given to
+	/// `socketDidDropMessage`. Payloads and control messages are never conflated.
+	///
+	/// By default, `messages::Datagram`s are keyed by their type, system
+	/// datagrams and the requests and responses of remote calls excluded.
+	/// Other messages are not conflated.
+	/// @param conflate True to conflate messages
+	inline void setConflating(const bool &conflate) { _isConflating = conflate; }
+
+	/// Sets the function giving the conflation key of messages
+	/// @param key The key extractor
+	inline void setConflationKey(const ConflationKey &key) { _conflationKey = key; }
+
+	/// Gives the number of messages replaced by a newer one before being sent
+	inline std::size_t getConflatedCount() const { return _conflatedCount; }
+
+	/// Gives the policy applied to messages sent while the queue is full
+	inline OverflowPolicy getOverflowPolicy() const { return _overflowPolicy; }
+
+	/// Sets the policy applied to messages sent while the queue is full
+	/// @param policy An overflow policy
+	inline void setOverflowPolicy(const OverflowPolicy &policy) { _overflowPolicy = policy; }
+
+	/// Gives the size in bytes of the messages waiting to be sent. Messages
+	/// are only measured if the queue has a size limit, or with the `batched`
+	/// emission type.
+	inline std::size_t getQueueSize() const { return _queueSize; }
+
+	/// Gives the number of messages waiting to be sent
+	inline std::size_t getQueueCount() const { return _queueCount; }
+
+	/// Gives the number of messages dropped because the queue was full
+	inline std::size_t getDroppedCount() const { return _droppedCount; }
+
 	/// Gives the remote endpoint this socket is connected to
 	inline Endpoint getRemote() const { return _remote; }
 
+	/// Gives the time of the last reception, see `ClockEstimator::now()`
+	inline int64_t getLastReceiveTime() const { return _lastReceiveTime; }
+
+	/// Gives the time the last asynchronous write started or made progress,
+	/// see `ClockEstimator::now()`
+	inline int64_t getLastSendTime() const { return _lastSendTime; }
+
+	/// Tell if an asynchronous write is in progress
+	inline bool isSending() const { return _isAsyncSending; }
+
+	/// Gives the interval in milliseconds between two pings, 0 if disabled
+	inline unsigned int getHeartbeat() const { return _heartbeatInterval; }
+
+	/// Sets the interval between two pings sent to the remote. Each pong
+	/// measures the round-trip time of the connection. Only sockets exchanging
+	/// `messages::Datagram`s in a protobuf format ping their remote.
+	/// @param interval An interval in milliseconds, 0 to disable the heartbeat
+	void setHeartbeat(const unsigned int &interval);
+
+	/// Gives the round-trip time statistics of the connection
+	inline RTTStatistics & getRTTStatistics() { return _rttStatistics; }
+
+	/// Gives the estimation of the remote clock, made from the pings. Converts
+	/// times between the remote and the local clocks.
+	inline ClockEstimator & getClockEstimator() { return _clockEstimator; }
+
+	/// Enables or disables the detection of a remote gone silently.
+	///
+	/// Everything received from the remote is an arrival for the failure
+	/// detector, which tells how unusual the time since the last one is. The
+	/// delegate is told when the remote is suspected, recovers, or is
+	/// considered gone. A heartbeat should be set on at least one side of the
+	/// connection, keeping the remote from going silent otherwise.
+	/// @param enabled True to detect failures
+	/// @param suspectPhi Suspicion level at which the remote is suspected
+	/// @param deadPhi Suspicion level at which the remote is considered gone
+	/// @param closeWhenDead True to close the socket once the remote is gone
+	void setFailureDetection(const bool &enabled, const double &suspectPhi = failureSuspectPhi, const double &deadPhi = failureDeadPhi, const bool &closeWhenDead = true);
+
+	/// Tell if the failure detection is enabled
+	inline bool isDetectingFailures() const { return _detectFailures; }
+
+	/// Gives the failure detector of the connection
+	inline FailureDetector & getFailureDetector() { return _failureDetector; }
+
+	/// Tell if the remote is suspected to be gone
+	inline bool isRemoteSuspected() const { return _remoteSuspected; }
+
+	/// Tell if the remote is considered gone
+	inline bool isRemoteLost() const { return _remoteLost; }
+
+	/// Tell if the socket decodes received messages in an arena
+	inline bool isUsingArena() const { return _receptionArena != nullptr; }
+
+	/// Enables or disables arena allocation of received messages.
+	///
+	/// When enabled, all the messages decoded from a single reception are
+	/// allocated in an arena, released in bulk once they have all been passed
+	/// to `SocketDelegate::socketDidReceiveTransient`.
+	/// @param useArena True to use an arena
+	/// @param blockSize Size of the arena memory block kept between receptions
+	void setUsingArena(const bool &useArena, const std::size_t &blockSize = 16384);
+
+	/// Gives the size in bytes of the largest frame the socket accepts
+	inline std::size_t getMaxFrameSize() const { return _maxFrameSize; }
+
+	/// Sets the size of the largest frame the socket accepts. The remote is
+	/// disconnected when announcing a larger frame, before any memory is
+	/// reserved for it. Compressed frames are bounded before and after their
+	/// decompression. With the JSON formats, the remote is disconnected once
+	/// more data is received without a delimiter.
+	/// @param size A size in bytes
+	inline void setMaxFrameSize(const std::size_t &size) { _maxFrameSize = size; }
+
+	/// Gives the number of bytes of buffer memory currently held by the socket
+	std::size_t getBufferMemory() const;
+
 	/// Gives the exchange format used by the socket
 	inline SocketFormat getFormat() const { return _format; }
 
@@ -101,8 +382,31 @@ public:
 	/// @param aFormat An exchange format
 	inline void setFormat(const SocketFormat &aFormat) {
 		_format = aFormat;
+
+		if(_format == compressed && !_compressor)
+			_compressor.reset(new Compressor());
+	}
+
+	/// Gives the codec used to compress messages with the `compressed` format
+	inline CompressionCodec getCompression() const { return _compressionCodec; }
+
+	/// Sets the codec used to compress messages with the `compressed` format.
+	/// The remote reads messages whatever the codec they were compressed with.
+	/// @param codec A compression codec
+	/// @param level Compression level, used by zstd when there is no dictionary
+	inline void setCompression(const CompressionCodec &codec, const int &level = 3) {
+		_compressionCodec = codec;
+		_compressionLevel = level;
 	}
 
+	/// Gives the size under which messages are sent uncompressed
+	inline std::size_t getCompressionThreshold() const { return _compressionThreshold; }
+
+	/// Sets the size under which messages are sent uncompressed. Messages
+	/// sent together are compressed together, and are compared as a whole.
+	/// @param threshold A size in bytes
+	inline void setCompressionThreshold(const std::size_t &threshold) { _compressionThreshold = threshold; }
+
 	// MARK: - Internal
 
 protected:
@@ -120,6 +424,10 @@ protected:
 	/// Executed when a fatal error occur during emission or reception
 	void onError();
 
+	/// Gives the arena in which received messages are allocated, if any
+	inline protobuf::Arena * getReceptionArena() { return _receptionArena.get(); }
+
+	/// Tell if the socket can ping its remote
 	virtual bool canPing() = 0;
 
 	virtual void ping(BaseSocket *) = 0;
@@ -139,26 +447,267 @@ private:
 	/// socket status isn't `SocketStatus::ready`
 	Endpoint _remote;
 
+	/// Aborts an asynchronous connection that takes too long
+	TimerWheel::TimerID _connectTimer = 0;
 
-	// MARK: - Emission
+	std::atomic<int64_t> _lastReceiveTime = {0};
+
+	// MARK: Heartbeat
+
+	unsigned int _heartbeatInterval = 0;
+
+	/// Sends the next ping
+	TimerWheel::TimerID _heartbeatTimer = 0;
+
+	std::mutex _heartbeatMutex;
+
+	RTTStatistics _rttStatistics;
+
+	ClockEstimator _clockEstimator;
+
+	/// Schedules the next ping of the heartbeat, if enabled
+	void scheduleHeartbeat();
+
+	// MARK: Failure detection
+
+	std::atomic<bool> _detectFailures = {false};
+
+	double _suspectPhi = failureSuspectPhi;
+
+	double _deadPhi = failureDeadPhi;
+
+	bool _closeWhenDead = true;
 
-	asio::deadline_timer _timer = asio::deadline_timer(Engine::instance()->getContext());
+	std::atomic<bool> _remoteSuspected = {false};
+
+	std::atomic<bool> _remoteLost = {false};
+
+	/// Checks the failure detector
+	TimerWheel::TimerID _failureTimer = 0;
+
+	FailureDetector _failureDetector;
+
+	/// Starts detecting failures on a new connection, if enabled
+	void startFailureDetection();
+
+	/// Schedules the next check of the failure detector
+	void scheduleFailureCheck();
+
+	/// Compares the suspicion level of the remote with the thresholds
+	void checkFailure();
+
+	/// Opens the underlying socket before connecting it
+	/// @return False if the socket could not be opened
+	bool openSocket();
+
+	/// Executed once the socket is connected to its remote
+	void onConnected();
+
+	/// Stops an asynchronous connection, and tells the delegate it failed
+	void abortConnection();
+
+
+	// MARK: - Emission
 
 	/// Mutex protecting from send errors
 	std::mutex _sendSyncMutex;
 
-	std::atomic<bool> _isAsyncSending;
+	std::atomic<bool> _isAsyncSending = {false};
+
+	std::atomic<int64_t> _lastSendTime = {0};
+
+	/// A message waiting to be sent asynchronously. Holds either a message to
+	/// format or a pre-formatted payload.
+	struct QueuedMessage {
+		const protobuf::Message * message = nullptr;
+
+		/// Set if the socket owns the message
+		std::shared_ptr<const protobuf::Message> ownedMessage;
+
+		std::shared_ptr<const SharedPayload> payload;
+
+		/// Size of the message, as accounted in the queue size
+		std::size_t size = 0;
+
+		Lane lane = normalLane;
+
+		/// Set for the placeholder of a conflated message. The message waits
+		/// in `_conflatedMessages` under the given key.
+		bool isConflated = false;
+
+		uint64_t key = 0;
+	};
+
+	/// The queues of the lanes
+	moodycamel::ConcurrentQueue<QueuedMessage> _asyncQueues[laneCount];
+
+	// MARK: Lanes
+
+	LaneScheduling _laneScheduling = LaneScheduling::strictPriority;
+
+	unsigned int _laneWeights[laneCount] = {1, 4, 2, 1};
+
+	/// Bytes each lane can still send on its turn, with the `weightedFair` scheduling
+	long long _laneDeficits[laneCount] = {0, 0, 0, 0};
+
+	/// The lane whose turn it is, with the `weightedFair` scheduling
+	unsigned int _fairLane = highLane;
+
+	/// Takes the next messages to send out of the lanes queues, following
+	/// the lanes scheduling
+	/// @param maxCount Maximum number of messages to take
+	void dequeueSendingMessages(const std::size_t &maxCount);
+
+	/// Tell if any lane has messages waiting
+	bool hasQueuedMessages() const;
+
+	// MARK: Conflation
+
+	bool _isConflating = false;
+
+	ConflationKey _conflationKey = defaultConflationKey;
+
+	/// The latest message of each key, waiting to be sent
+	std::unordered_map<uint64_t, QueuedMessage> _conflatedMessages;
+
+	std::mutex _conflationMutex;
+
+	std::atomic<std::size_t> _conflatedCount = {0};
+
+	/// Keys datagrams by their type, system datagrams and remote calls excluded
+	static bool defaultConflationKey(const protobuf::Message * message, uint64_t &key);
+
+	/// Stores the given message as the latest value of the given key
+	/// @param key The conflation key of the message
+	/// @param queued The message
+	/// @param canInsert False to only replace an existing value
+	/// @return True if the message replaced a value, and has nothing left to queue
+	bool storeConflated(const uint64_t &key, QueuedMessage &queued, const bool &canInsert);
+
+	/// Replaces the given placeholder by the message it stands for
+	/// @return False if the message is not there anymore
+	bool resolveConflated(QueuedMessage &queued);
+
+	/// Adds the given message to the queue of its lane, applying the
+	/// overflow policy if the queue is full. The control lane is not limited.
+	/// @return False if the message was dropped
+	bool enqueue(QueuedMessage &&queued);
+
+	/// Tell if a message of the given size fits in the queue
+	bool canQueue(const std::size_t &size) const;
+
+	/// Tell if the queue is above the given part of its limits
+	bool isQueueAbove(const float &watermark) const;
+
+	/// Removes messages taken out of the queue from its size, and tells the
+	/// delegate and the blocked senders if the queue drained
+	void onDequeue(const std::size_t &size, const std::size_t &count);
+
+	/// Tells the delegate about a message it owns that will not be sent
+	void notifyDropped(const QueuedMessage &queued);
+
+	// MARK: Queue limits
 
-	moodycamel::ConcurrentQueue<const protobuf::Message *> _asyncQueue;
+	std::size_t _queueMaxSize = queueMaxSize;
+
+	std::size_t _queueMaxCount = queueMaxCount;
+
+	float _queueHighWatermark = queueHighWatermark;
+
+	float _queueLowWatermark = queueLowWatermark;
+
+	OverflowPolicy _overflowPolicy = OverflowPolicy::block;
+
+	/// Size and number of the messages in the asynchronous queue
+	std::atomic<std::size_t> _queueSize = {0};
+	std::atomic<std::size_t> _queueCount = {0};
+
+	std::atomic<std::size_t> _droppedCount = {0};
+
+	/// Set once the queue went above its high watermark, until it goes under its low watermark
+	std::atomic<bool> _isQueueFilled = {false};
+
+	/// Senders waiting for the queue to make room, with the `block` policy
+	std::atomic<unsigned int> _blockedSenders = {0};
+
+	std::mutex _overflowMutex;
+
+	std::condition_variable _overflowCondition;
+
+	/// The messages being sent asynchronously
+	std::vector<QueuedMessage> _sendingMessages;
+
+	/// Formatted messages being sent asynchronously, one per message
+	std::vector<std::string> _sendingData;
+
+	/// The buffers given to the gather write, pointing to `_sendingData` or to the
+	/// sent payloads
+	std::vector<asio::const_buffer> _sendingBuffers;
+
+	// MARK: Batching
+
+	std::size_t _batchMaxSize = batchMaxSize;
+
+	std::size_t _batchMaxCount = asyncBatchSize;
+
+	unsigned int _batchDeadline = batchDeadline;
+
+	/// Size and number of the messages waiting in the current batch
+	std::atomic<std::size_t> _batchSize = {0};
+	std::atomic<std::size_t> _batchCount = {0};
+
+	/// Sends the current batch once its deadline is reached
+	asio::deadline_timer _batchTimer = asio::deadline_timer(Engine::instance()->getContext());
+
+	/// Mutex protecting the batch timer
+	std::mutex _batchMutex;
+
+	/// Queues the given message in the current batch, and sends the batch if
+	/// it reaches one of its limits
+	/// @param queued The message to queue
+	void sendBatched(QueuedMessage &&queued);
+
+	// MARK: Compression
+
+	/// Compression contexts, used with the `compressed` format
+	std::unique_ptr<Compressor> _compressor;
+
+	CompressionCodec _compressionCodec = zstd;
+
+	int _compressionLevel = 3;
+
+	std::size_t _compressionThreshold = Compressor::defaultThreshold;
+
+	/// Framed messages waiting to be compressed together
+	std::string _compressionInput;
+
+	/// Sends the frame telling the remote which dictionaries can be used
+	void sendCompressionHello();
+
+	/// Compresses the messages waiting in `_compressionInput` in a frame
+	/// @param dictionary The dictionary to use, if any
+	/// @param output The receiving string
+	void appendCompressedFrame(const CompressionDictionary * dictionary, std::string &output);
 
 	/// Mutex protecting from receive errors
 	std::mutex _receiveMutex;
 
-	/// Synchronous send output buffer
-	asio::streambuf _outputBuffer;
+	/// Synchronous send output buffer. Messages are serialized in it in
+	/// place, its memory is kept between messages.
+	std::string _sendSyncData;
+
+	/// Delay in milliseconds after which a synchronous send fails
+	unsigned int _sendTimeout = sendTimeout;
+
+	/// The buffers given to the synchronous writes, kept between messages
+	std::vector<iovec> _sendSyncVectors;
 
-	/// Synchronous send output stream
-	std::ostream _outputStream;
+	/// Writes the given buffers on the socket, waiting for room in the socket
+	/// send buffer up to the send timeout.
+	/// @param buffers The buffers to write
+	/// @param count The number of buffers
+	/// @param error Receives the error, if any
+	void writeSync(const asio::const_buffer * buffers, const std::size_t &count, boost::system::error_code &error);
 
 public:
 
@@ -167,56 +716,106 @@ public:
 	void sendSync(const protobuf::Message * message);
 
 	/// Send a message to the server asynchronously
-	void sendAsync(const protobuf::Message * message);
+	/// @param message The message to send
+	/// @param lane The priority lane of the message
+	void sendAsync(const protobuf::Message * message, const Lane &lane = normalLane);
+
+	/// Send an owned message to the server asynchronously
+	/// @param message The message to send
+	/// @param lane The priority lane of the message
+	void sendAsync(std::shared_ptr<const protobuf::Message> message, const Lane &lane = normalLane);
+
+	/// Send a pre-formatted payload to the server synchronously.
+	/// @param payload The payload to send
+	void sendSync(const std::shared_ptr<const SharedPayload> &payload);
+
+	/// Send a pre-formatted payload to the server asynchronously
+	/// @param payload The payload to send
+	/// @param lane The priority lane of the payload
+	void sendAsync(const std::shared_ptr<const SharedPayload> &payload, const Lane &lane = normalLane);
 
 protected:
 
 	void sendAsyncInternal();
 
-	/// Format the given message in the format defined by `getFormat()` and put it in the given `std::ostream`;
+	/// Empties the asynchronous queue, releasing the owned messages and
+	/// payloads. The delegate is told about every dropped message it owns.
+	void dropQueuedMessages();
+
+	/// Format the given message in the format defined by `getFormat()` and append it to the given string
 	/// @param message The message to format
-	/// @param _outputStream The receiving stream
-	void formatMessageToStream(const protobuf::Message * message, std::ostream & _outputStream);
+	/// @param output The receiving string
+	void formatMessageToString(const protobuf::Message * message, std::string & output);
 
-	virtual protobuf::Message * decodeMessageFromBuffer(boost::array<char, RECEPTION_BUFFER_SIZE> & buffer, const std::size_t &bytes_transferred) = 0;
+	/// Decodes a message from the given stream. The stream spans exactly one message.
+	virtual protobuf::Message * decodeMessageFromBuffer(protobuf::io::ZeroCopyInputStream * stream) = 0;
 
-	virtual protobuf::Message * decodeMessageFromBuffer(boost::asio::streambuf *, const std::size_t &bytes_transferred) = 0;
+	/// Decodes a message from the given JSON text
+	virtual protobuf::Message * decodeMessageFromJSON(const char * text, const std::size_t &size) = 0;
 
 	/// Called everytime a valid datagram is received
 	virtual void onReceive(protobuf::Message * message) = 0;
 
 private:
 
-	// MARK: Timing
-
-	inline void startTimer() {
-		_timer.expires_from_now(boost::posix_time::seconds(2));
-		_timer.async_wait([&] (const boost::system::error_code &error) {
-			// Operation aborted is send if the timer is cancelled, meaning no timeout1
-			if(error != boost::asio::error::operation_aborted) {
-				LOG_ERROR("Socket send timeout");
-				close();
-			}
-		});
-	}
+	// MARK: - Reception
 
-	inline void endTimer() {
-		_timer.cancel();
-	}
+	/// The reception buffer holding incoming informations. Data is received
+	/// in its free region and messages are parsed in place.
+	/// The buffer only holds memory while it has data in it. An incomplete
+	/// message received previously stays in it until the rest of it is received.
+	RingBuffer _receptionBuffer;
 
+	/// Offset in the reception buffer up to which delimited messages have
+	/// already been looked for
+	std::size_t _receptionScanOffset = 0;
 
-	// MARK: - Reception
+	/// Size of the largest frame accepted from the remote
+	std::size_t _maxFrameSize = maxFrameSize;
 
-	/// The reception buffer holding incoming informations
-	boost::array<char, RECEPTION_BUFFER_SIZE> _receptionBuffer;
+	/// The arena holding the messages decoded from a reception, if used
+	std::unique_ptr<protobuf::Arena> _receptionArena;
 
-	boost::asio::streambuf _receptionStreamBuffer;
+	/// The memory block used by the reception arena
+	std::unique_ptr<char[]> _receptionArenaBlock;
 
 	/// Prepare the connection to receive new datagram
 	void prepareReceive();
 
+	/// Called when data is available on the socket. Borrows a buffer large enough and receives the data.
+	void handleReadable(const boost::system::error_code &error);
+
 	/// Handles received data from the network
 	void handleReceive(const boost::system::error_code &error, std::size_t bytes_transferred);
+
+	/// Decodes the whole content of the reception buffer as a single message.
+	/// Used with `SocketFormat::protobuf`
+	void decodeMessage();
+
+	/// Decodes all the complete JSON messages available in the reception buffer.
+	/// @param delimiter The sequence ending each message
+	/// @param delimiterSize The size of the delimiter
+	/// @return False if the stream is corrupted and the socket was closed
+	bool decodeJSONMessages(const char * delimiter, const std::size_t &delimiterSize);
+
+	/// Decodes all the complete frames available in the reception buffer, leaving
+	/// any incomplete one in it for the next reception.
+	/// @return False if the stream is corrupted and the socket was closed
+	bool decodeFrames();
+
+	/// Decodes the messages of a frame of the `compressed` format
+	/// @param frame The frame content, after its size prefix
+	/// @param size Size of the frame content
+	/// @return False if the frame is invalid
+	bool decodeCompressedFrame(const char * frame, const std::size_t &size);
+
+	/// Reads the varint size prefix of a frame
+	/// @param buffer Start of the frame
+	/// @param size Number of bytes available in the buffer
+	/// @param frameSize Receives the size of the frame body
+	/// @param headerSize Receives the size of the prefix
+	/// @return 1 if the prefix is complete, 0 if more bytes are needed, -1 if it is malformed
+	static int readFrameHeader(const char * buffer, const std::size_t &size, std::size_t &frameSize, std::size_t &headerSize);
 };
 
 } /* ::network */
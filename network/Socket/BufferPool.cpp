@@ -0,0 +1,107 @@
+//
+//  BufferPool.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-03.
+//
+
+#include "BufferPool.hpp"
+
+namespace network {
+
+BufferPool * BufferPool::_instance = nullptr;
+
+constexpr std::size_t BufferPool::minimumBufferSize;
+
+// MARK: - Buffers
+
+BufferPool::Buffer BufferPool::acquire(const std::size_t &size) {
+	Buffer buffer;
+
+	if(size > _maximumBufferSize)
+		return buffer;
+
+	const std::size_t index = sizeClass(size);
+	buffer.capacity = minimumBufferSize << index;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(index < _freeBuffers.size() && !_freeBuffers[index].empty()) {
+		// Reuse a retained buffer
+		buffer.data = std::move(_freeBuffers[index].back());
+		_freeBuffers[index].pop_back();
+		_retainedMemory -= buffer.capacity;
+	} else {
+		buffer.data.reset(new char[buffer.capacity]);
+	}
+
+	_lentMemory += buffer.capacity;
+
+	return buffer;
+}
+
+void BufferPool::release(Buffer &buffer) {
+	if(!buffer.data)
+		return;
+
+	const std::size_t index = sizeClass(buffer.capacity);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_lentMemory -= buffer.capacity;
+
+	if(_retainedMemory + buffer.capacity <= _memoryBudget) {
+		// Keep the buffer for later
+		if(index >= _freeBuffers.size())
+			_freeBuffers.resize(index + 1);
+
+		_freeBuffers[index].push_back(std::move(buffer.data));
+		_retainedMemory += buffer.capacity;
+	}
+
+	buffer.data.reset();
+	buffer.capacity = 0;
+}
+
+// MARK: - Getters & Setters
+
+void BufferPool::setMemoryBudget(const std::size_t &budget) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_memoryBudget = budget;
+	trim();
+}
+
+std::size_t BufferPool::getLentMemory() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _lentMemory;
+}
+
+std::size_t BufferPool::getRetainedMemory() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _retainedMemory;
+}
+
+// MARK: - Internal
+
+std::size_t BufferPool::sizeClass(const std::size_t &size) {
+	std::size_t index = 0;
+
+	while((minimumBufferSize << index) < size)
+		++index;
+
+	return index;
+}
+
+void BufferPool::trim() {
+	for(std::size_t index = _freeBuffers.size(); index-- > 0 && _retainedMemory > _memoryBudget;) {
+		std::vector<std::unique_ptr<char[]>> &buffers = _freeBuffers[index];
+
+		while(!buffers.empty() && _retainedMemory > _memoryBudget) {
+			buffers.pop_back();
+			_retainedMemory -= minimumBufferSize << index;
+		}
+	}
+}
+
+} /* ::network */
@@ -0,0 +1,111 @@
+//
+//  BufferPool.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-03.
+//
+
+#ifndef BufferPool_hpp
+#define BufferPool_hpp
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace network {
+
+/// The buffer pool lends reception buffers to the sockets.
+///
+/// Sockets only hold a buffer while they have data to process. Once a buffer
+/// is given back, it is kept in the pool for reuse, as long as the memory kept
+/// by the pool stays under its budget.
+///
+/// Buffers sizes are powers of two, starting at `minimumBufferSize`.
+class BufferPool {
+public:
+
+	// MARK: - Singleton
+
+	/// Singleton accessor
+	static BufferPool * instance() {
+		if(_instance == nullptr)
+			_instance = new BufferPool();
+
+		return _instance;
+	}
+
+	// MARK: - Buffers
+
+	/// Size of the smallest buffer lent by the pool
+	static constexpr std::size_t minimumBufferSize = 4096;
+
+	/// A block of memory lent by the pool
+	struct Buffer {
+		std::unique_ptr<char[]> data;
+
+		std::size_t capacity = 0;
+	};
+
+	/// Lends a buffer of at least the given size.
+	/// @param size The minimum size of the buffer
+	/// @return A buffer, empty if the requested size is above the maximum buffer size
+	Buffer acquire(const std::size_t &size);
+
+	/// Gives back a buffer to the pool. The given buffer is emptied.
+	/// @param buffer A buffer previously lent by the pool
+	void release(Buffer &buffer);
+
+	// MARK: - Getters & Setters
+
+	/// Gives the maximum number of bytes the pool keeps for reuse
+	inline std::size_t getMemoryBudget() const { return _memoryBudget; }
+
+	/// Sets the maximum number of bytes the pool keeps for reuse. Buffers over
+	/// the budget are freed immediately.
+	void setMemoryBudget(const std::size_t &budget);
+
+	/// Gives the size of the largest buffer the pool can lend
+	inline std::size_t getMaximumBufferSize() const { return _maximumBufferSize; }
+
+	/// Sets the size of the largest buffer the pool can lend. This is also the
+	/// size of the largest message a socket can receive.
+	inline void setMaximumBufferSize(const std::size_t &size) { _maximumBufferSize = size; }
+
+	/// Gives the number of bytes currently lent to sockets
+	std::size_t getLentMemory();
+
+	/// Gives the number of bytes currently kept by the pool for reuse
+	std::size_t getRetainedMemory();
+
+private:
+
+	BufferPool() = default;
+
+	/// The singleton instance of the pool
+	static BufferPool * _instance;
+
+	/// Gives the index of the smallest size class holding the given size
+	static std::size_t sizeClass(const std::size_t &size);
+
+	/// Frees retained buffers, largest first, until the budget is respected.
+	/// Must be called with the mutex locked.
+	void trim();
+
+	std::mutex _mutex;
+
+	/// Buffers available for reuse, by size class
+	std::vector<std::vector<std::unique_ptr<char[]>>> _freeBuffers;
+
+	std::size_t _memoryBudget = 16 * 1024 * 1024;
+
+	std::size_t _maximumBufferSize = 64 * 1024 * 1024;
+
+	std::size_t _lentMemory = 0;
+
+	std::size_t _retainedMemory = 0;
+};
+
+} /* ::network */
+
+#endif /* BufferPool_hpp */
@@ -0,0 +1,140 @@
+//
+//  ClockEstimator.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <algorithm>
+#include <chrono>
+
+#include "ClockEstimator.hpp"
+
+namespace network {
+
+int64_t ClockEstimator::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ClockEstimator::addSample(const int64_t &sent, const int64_t &received, const int64_t &replied, const int64_t &answered) {
+	Sample sample;
+	sample.time = sent + (answered - sent) / 2;
+	sample.offset = ((received - sent) + (replied - answered)) / 2;
+	sample.delay = (answered - sent) - (replied - received);
+
+	// The clocks went backward, or the remote answered out of order
+	if(sample.delay < 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_samples[_next] = sample;
+	_next = (_next + 1) % sampleCount;
+	_count = std::min(_count + 1, sampleCount);
+
+	estimate();
+}
+
+void ClockEstimator::reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_count = 0;
+	_next = 0;
+	_reference = Sample();
+	_drift = 0;
+}
+
+bool ClockEstimator::isSynchronized() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _count > 0;
+}
+
+int64_t ClockEstimator::getOffset(const int64_t &localTime) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return offsetAt(localTime);
+}
+
+double ClockEstimator::getDrift() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _drift * 1e9;
+}
+
+int64_t ClockEstimator::getDelay() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _reference.delay;
+}
+
+int64_t ClockEstimator::toLocalTime(const int64_t &remoteTime) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// The offset is taken at the local time approached with the reference offset
+	return remoteTime - offsetAt(remoteTime - _reference.offset);
+}
+
+int64_t ClockEstimator::toRemoteTime(const int64_t &localTime) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return localTime + offsetAt(localTime);
+}
+
+int64_t ClockEstimator::getElapsed(const int64_t &remoteTime) {
+	return now() - toLocalTime(remoteTime);
+}
+
+void ClockEstimator::estimate() {
+	// The offset comes from the least delayed of the latest samples
+	const unsigned int filtered = std::min(_count, filterCount);
+
+	_reference = _samples[(_next + sampleCount - 1) % sampleCount];
+
+	for(unsigned int i = 1; i < filtered; ++i) {
+		const Sample &sample = _samples[(_next + sampleCount - 1 - i) % sampleCount];
+
+		if(sample.delay < _reference.delay)
+			_reference = sample;
+	}
+
+	// The drift is fitted on the samples with a short enough round-trip
+	int64_t minDelay = _reference.delay;
+
+	for(unsigned int i = 0; i < _count; ++i)
+		minDelay = std::min(minDelay, _samples[i].delay);
+
+	const double maxDelay = std::max<double>(minDelay * delayTolerance, minDelay + 1000);
+
+	double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+	unsigned int n = 0;
+
+	for(unsigned int i = 0; i < _count; ++i) {
+		const Sample &sample = _samples[i];
+
+		if(sample.delay > maxDelay)
+			continue;
+
+		// Centered on the reference, to keep the precision
+		const double x = sample.time - _reference.time;
+		const double y = sample.offset - _reference.offset;
+
+		sumX += x;
+		sumY += y;
+		sumXX += x * x;
+		sumXY += x * y;
+		++n;
+	}
+
+	const double variance = n * sumXX - sumX * sumX;
+
+	// A few samples over a short time only measure noise
+	if(n < 4 || variance <= 0) {
+		_drift = 0;
+		return;
+	}
+
+	_drift = (n * sumXY - sumX * sumY) / variance;
+}
+
+int64_t ClockEstimator::offsetAt(const int64_t &localTime) const {
+	return _reference.offset + (int64_t)(_drift * (localTime - _reference.time));
+}
+
+} /* ::network */
@@ -0,0 +1,117 @@
+//
+//  ClockEstimator.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef ClockEstimator_hpp
+#define ClockEstimator_hpp
+
+#include <cstdint>
+#include <mutex>
+
+namespace network {
+
+/// Estimates the offset and the drift of the clock of a remote, NTP-style,
+/// from the four timestamps of a ping: sent, received by the remote, sent
+/// back by the remote, and received.
+///
+/// The offset is taken from the sample with the shortest round-trip among the
+/// last ones, as its timestamps are the least delayed by queues. The drift is
+/// the slope of the offsets of the good samples over time.
+///
+/// Times are in nanoseconds on the monotonic clock of each machine, as given
+/// by `now()`. Messages stamped with `now()` by the remote can be converted to
+/// the local clock. Statistics can be read from any thread.
+class ClockEstimator {
+public:
+
+	/// Gives the current time on the local monotonic clock, in nanoseconds
+	static int64_t now();
+
+	/// Adds the timestamps of a ping to the estimation
+	/// @param sent Time the ping was sent, on the local clock
+	/// @param received Time the remote received the ping, on its clock
+	/// @param replied Time the remote sent the pong, on its clock
+	/// @param answered Time the pong was received, on the local clock
+	void addSample(const int64_t &sent, const int64_t &received, const int64_t &replied, const int64_t &answered);
+
+	/// Clears the estimation
+	void reset();
+
+	/// Tell if the estimation has at least one sample
+	bool isSynchronized();
+
+	/// Gives the offset of the remote clock from the local clock, at the
+	/// given local time
+	/// @param localTime A time on the local clock
+	int64_t getOffset(const int64_t &localTime = now());
+
+	/// Gives the drift of the remote clock, in nanoseconds per second
+	double getDrift();
+
+	/// Gives the round-trip time of the sample the offset is taken from
+	int64_t getDelay();
+
+	/// Converts a time on the remote clock to the local clock
+	/// @param remoteTime A time on the remote clock
+	int64_t toLocalTime(const int64_t &remoteTime);
+
+	/// Converts a time on the local clock to the remote clock
+	/// @param localTime A time on the local clock
+	int64_t toRemoteTime(const int64_t &localTime);
+
+	/// Gives the time elapsed since the given remote time, using the local
+	/// clock. With a message stamped with its send time by the remote, this
+	/// gives its one-way latency.
+	/// @param remoteTime A time on the remote clock
+	int64_t getElapsed(const int64_t &remoteTime);
+
+private:
+
+	/// Number of samples kept for the drift
+	static constexpr unsigned int sampleCount = 64;
+
+	/// Number of latest samples the offset is picked from
+	static constexpr unsigned int filterCount = 8;
+
+	/// Samples with a round-trip over this many times the shortest are left
+	/// out of the drift
+	static constexpr double delayTolerance = 2.0;
+
+	struct Sample {
+		/// Local time of the middle of the exchange
+		int64_t time = 0;
+
+		int64_t offset = 0;
+
+		int64_t delay = 0;
+	};
+
+	std::mutex _mutex;
+
+	/// The latest samples, in a ring
+	Sample _samples[sampleCount];
+
+	unsigned int _count = 0;
+
+	/// Position of the next sample in the ring
+	unsigned int _next = 0;
+
+	/// The filtered sample, origin of the estimation
+	Sample _reference;
+
+	double _drift = 0;
+
+	/// Computes the offset and the drift from the samples
+	void estimate();
+
+	/// Gives the offset at the given local time. Must be called holding the mutex
+	int64_t offsetAt(const int64_t &localTime) const;
+};
+
+} /* ::network */
+
+#endif /* ClockEstimator_hpp */
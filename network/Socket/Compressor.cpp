@@ -0,0 +1,335 @@
+//
+//  Compressor.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-12.
+//
+
+#include "Compressor.hpp"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <lz4.h>
+#include <zdict.h>
+#include <zstd.h>
+
+#include "BufferPool.hpp"
+
+namespace network {
+
+/// FNV-1a hash of the given bytes
+static uint32_t hashOf(const std::string &data) {
+	uint32_t hash = 2166136261u;
+
+	for(const char &c: data) {
+		hash ^= (uint8_t)c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// MARK: - Dictionaries
+
+CompressionDictionaries * CompressionDictionaries::_instance = nullptr;
+
+CompressionDictionary::~CompressionDictionary() {
+	ZSTD_freeCDict(zstdCompression);
+	ZSTD_freeDDict(zstdDecompression);
+}
+
+void CompressionDictionaries::add(const MessageRegistry::TypeID &typeID, const std::string &data, const int &level) {
+	std::unique_ptr<CompressionDictionary> dictionary(new CompressionDictionary());
+	dictionary->typeID = typeID;
+	dictionary->data = data;
+	dictionary->hash = hashOf(data);
+	dictionary->zstdCompression = ZSTD_createCDict(data.data(), data.size(), level);
+	dictionary->zstdDecompression = ZSTD_createDDict(data.data(), data.size());
+
+	_dictionaries[typeID] = std::move(dictionary);
+}
+
+const CompressionDictionary * CompressionDictionaries::get(const MessageRegistry::TypeID &typeID) const {
+	auto it = _dictionaries.find(typeID);
+
+	if(it == _dictionaries.end())
+		return nullptr;
+
+	return it->second.get();
+}
+
+MessageRegistry::TypeID CompressionDictionaries::typeOf(const protobuf::Message * message) {
+	// Datagrams are identified by the type of their payload
+	if(message->GetDescriptor() == messages::Datagram::descriptor()) {
+		const messages::Datagram * datagram = static_cast<const messages::Datagram *>(message);
+
+		if(datagram->payload_type() != MessageRegistry::undefined)
+			return datagram->payload_type();
+	}
+
+	return MessageRegistry::instance()->typeID(message->GetDescriptor());
+}
+
+std::string CompressionDictionaries::train(const std::vector<std::string> &samples, const std::size_t &capacity) {
+	// The trainer takes all the samples one after the other
+	std::string samplesData;
+	std::vector<std::size_t> samplesSizes;
+
+	for(const std::string &sample: samples) {
+		samplesData += sample;
+		samplesSizes.push_back(sample.size());
+	}
+
+	std::string dictionary(capacity, '\0');
+	const std::size_t size = ZDICT_trainFromBuffer(&dictionary[0], capacity, samplesData.data(), samplesSizes.data(), (unsigned int)samplesSizes.size());
+
+	if(ZDICT_isError(size))
+		return "";
+
+	dictionary.resize(size);
+	return dictionary;
+}
+
+// MARK: - Compressor
+
+constexpr uint8_t Compressor::helloFrame;
+constexpr std::size_t Compressor::defaultThreshold;
+constexpr std::size_t Compressor::retainedBufferSize;
+
+Compressor::Compressor():
+_zstdCompression(ZSTD_createCCtx()),
+_zstdDecompression(ZSTD_createDCtx()),
+_lz4Stream(LZ4_createStream()) {}
+
+Compressor::~Compressor() {
+	ZSTD_freeCCtx(_zstdCompression);
+	ZSTD_freeDCtx(_zstdDecompression);
+	LZ4_freeStream(_lz4Stream);
+}
+
+// MARK: - Emission
+
+void Compressor::appendFrame(const char * messages, const std::size_t &size, const CompressionCodec &codec, const int &level, const std::size_t &threshold, const CompressionDictionary * dictionary, std::string &output) {
+	std::size_t compressedSize = 0;
+
+	if(codec != uncompressed && size >= threshold && size <= LZ4_MAX_INPUT_SIZE) {
+		switch(codec) {
+			case lz4: {
+				const int bound = LZ4_compressBound((int)size);
+				_compressionBuffer.resize(bound);
+
+				int result;
+
+				if(dictionary) {
+					LZ4_loadDict(_lz4Stream, dictionary->data.data(), (int)dictionary->data.size());
+					result = LZ4_compress_fast_continue(_lz4Stream, messages, &_compressionBuffer[0], (int)size, bound, 1);
+				} else {
+					result = LZ4_compress_fast_extState(_lz4Stream, messages, &_compressionBuffer[0], (int)size, bound, 1);
+				}
+
+				compressedSize = result > 0 ? result : 0;
+			} break;
+
+			case zstd: {
+				const std::size_t bound = ZSTD_compressBound(size);
+				_compressionBuffer.resize(bound);
+
+				const std::size_t result = dictionary
+					? ZSTD_compress_usingCDict(_zstdCompression, &_compressionBuffer[0], bound, messages, size, dictionary->zstdCompression)
+					: ZSTD_compressCCtx(_zstdCompression, &_compressionBuffer[0], bound, messages, size, level);
+
+				compressedSize = ZSTD_isError(result) ? 0 : result;
+			} break;
+
+			case uncompressed:
+				break;
+		}
+	}
+
+	// Messages are sent as-is if compressing them is not worth it
+	if(compressedSize == 0 || compressedSize >= size) {
+		appendUncompressedHeader(size, output);
+		output.append(messages, size);
+		return;
+	}
+
+	// Frame type, size of the messages, and dictionary
+	uint8_t header[11];
+	header[0] = codec;
+
+	uint8_t * headerEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)size, header + 1);
+	headerEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray(dictionary ? dictionary->typeID : MessageRegistry::undefined, headerEnd);
+
+	const std::size_t headerSize = headerEnd - header;
+
+	// Size prefix
+	uint8_t prefix[5];
+	uint8_t * prefixEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)(headerSize + compressedSize), prefix);
+
+	output.append(reinterpret_cast<char *>(prefix), prefixEnd - prefix);
+	output.append(reinterpret_cast<char *>(header), headerSize);
+	output.append(_compressionBuffer.data(), compressedSize);
+}
+
+void Compressor::appendUncompressedHeader(const std::size_t &size, std::string &output) {
+	uint8_t prefix[6];
+	uint8_t * prefixEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)(size + 1), prefix);
+	*prefixEnd++ = uncompressed;
+
+	output.append(reinterpret_cast<char *>(prefix), prefixEnd - prefix);
+}
+
+void Compressor::appendHello(std::string &output) {
+	const CompressionDictionaries * dictionaries = CompressionDictionaries::instance();
+
+	std::string hello;
+	hello += (char)helloFrame;
+
+	{
+		protobuf::io::StringOutputStream stream(&hello);
+		protobuf::io::CodedOutputStream coded(&stream);
+
+		coded.WriteVarint32((uint32_t)dictionaries->_dictionaries.size());
+
+		for(const auto &it: dictionaries->_dictionaries) {
+			coded.WriteVarint32(it.first);
+			coded.WriteLittleEndian32(it.second->hash);
+		}
+	}
+
+	uint8_t prefix[5];
+	uint8_t * prefixEnd = protobuf::io::CodedOutputStream::WriteVarint32ToArray((uint32_t)hello.size(), prefix);
+
+	output.append(reinterpret_cast<char *>(prefix), prefixEnd - prefix);
+	output += hello;
+}
+
+// MARK: - Reception
+
+bool Compressor::readFrame(const char * frame, const std::size_t &size, const std::size_t &maxSize, const char * &messages, std::size_t &messagesSize) {
+	messages = nullptr;
+	messagesSize = 0;
+
+	if(size == 0)
+		return false;
+
+	const uint8_t type = (uint8_t)frame[0];
+
+	if(type == uncompressed) {
+		messages = frame + 1;
+		messagesSize = size - 1;
+		return true;
+	}
+
+	if(type == helloFrame)
+		return readHello(frame + 1, size - 1);
+
+	if(type != lz4 && type != zstd)
+		return false;
+
+	// Size of the messages, and dictionary
+	protobuf::io::CodedInputStream header(reinterpret_cast<const uint8_t *>(frame + 1), (int)(size - 1));
+
+	uint32_t rawSize, dictionaryType;
+
+	if(!header.ReadVarint32(&rawSize) || !header.ReadVarint32(&dictionaryType))
+		return false;
+
+	// The remote cannot make the socket reserve more than a frame
+	if(rawSize > maxSize || rawSize > BufferPool::instance()->getMaximumBufferSize())
+		return false;
+
+	const CompressionDictionary * dictionary = nullptr;
+
+	if(dictionaryType != MessageRegistry::undefined) {
+		dictionary = CompressionDictionaries::instance()->get(dictionaryType);
+
+		if(dictionary == nullptr)
+			return false;
+	}
+
+	const char * data = frame + 1 + header.CurrentPosition();
+	const std::size_t dataSize = size - 1 - header.CurrentPosition();
+
+	_decompressionBuffer.resize(rawSize);
+
+	if(type == lz4) {
+		const int result = dictionary
+			? LZ4_decompress_safe_usingDict(data, &_decompressionBuffer[0], (int)dataSize, (int)rawSize, dictionary->data.data(), (int)dictionary->data.size())
+			: LZ4_decompress_safe(data, &_decompressionBuffer[0], (int)dataSize, (int)rawSize);
+
+		if(result != (int)rawSize)
+			return false;
+	} else {
+		const std::size_t result = dictionary
+			? ZSTD_decompress_usingDDict(_zstdDecompression, &_decompressionBuffer[0], rawSize, data, dataSize, dictionary->zstdDecompression)
+			: ZSTD_decompressDCtx(_zstdDecompression, &_decompressionBuffer[0], rawSize, data, dataSize);
+
+		if(ZSTD_isError(result) || result != rawSize)
+			return false;
+	}
+
+	messages = _decompressionBuffer.data();
+	messagesSize = rawSize;
+	return true;
+}
+
+void Compressor::releaseFrame() {
+	if(_decompressionBuffer.capacity() <= retainedBufferSize) {
+		_decompressionBuffer.clear();
+		return;
+	}
+
+	std::string().swap(_decompressionBuffer);
+}
+
+bool Compressor::readHello(const char * data, const std::size_t &size) {
+	protobuf::io::CodedInputStream hello(reinterpret_cast<const uint8_t *>(data), (int)size);
+
+	uint32_t count;
+
+	if(!hello.ReadVarint32(&count))
+		return false;
+
+	std::unordered_map<MessageRegistry::TypeID, uint32_t> dictionaries;
+
+	for(uint32_t i = 0; i < count; ++i) {
+		uint32_t typeID, hash;
+
+		if(!hello.ReadVarint32(&typeID) || !hello.ReadLittleEndian32(&hash))
+			return false;
+
+		dictionaries[typeID] = hash;
+	}
+
+	std::lock_guard<std::mutex> lock(_remoteDictionariesMutex);
+	_remoteDictionaries.swap(dictionaries);
+
+	return true;
+}
+
+const CompressionDictionary * Compressor::remoteDictionary(const MessageRegistry::TypeID &typeID) {
+	if(typeID == MessageRegistry::undefined)
+		return nullptr;
+
+	const CompressionDictionary * dictionary = CompressionDictionaries::instance()->get(typeID);
+
+	if(dictionary == nullptr)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(_remoteDictionariesMutex);
+	auto it = _remoteDictionaries.find(typeID);
+
+	// Only use the dictionary if the remote has the exact same one
+	if(it == _remoteDictionaries.end() || it->second != dictionary->hash)
+		return nullptr;
+
+	return dictionary;
+}
+
+std::size_t Compressor::getBufferMemory() const {
+	return _compressionBuffer.capacity() + _decompressionBuffer.capacity();
+}
+
+} /* ::network */
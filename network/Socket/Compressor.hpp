@@ -0,0 +1,206 @@
+//
+//  Compressor.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-12.
+//
+
+#ifndef Compressor_hpp
+#define Compressor_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/message.h>
+
+#include "SocketStatus.hpp"
+#include "../Messages/MessageRegistry.hpp"
+
+namespace protobuf = google::protobuf;
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+union LZ4_stream_u;
+
+namespace network {
+
+/// A pre-trained compression dictionary, used for the messages of a single type
+struct CompressionDictionary {
+	/// Id of the message type using the dictionary, in the `MessageRegistry`
+	MessageRegistry::TypeID typeID = MessageRegistry::undefined;
+
+	/// The dictionary content
+	std::string data;
+
+	/// Hash of the content, used to make sure both sides have the same dictionary
+	uint32_t hash = 0;
+
+	/// Digested dictionaries, for zstd
+	ZSTD_CDict_s * zstdCompression = nullptr;
+	ZSTD_DDict_s * zstdDecompression = nullptr;
+
+	CompressionDictionary() = default;
+
+	CompressionDictionary(const CompressionDictionary &) = delete;
+
+	~CompressionDictionary();
+};
+
+/// The compression dictionaries shared by all the sockets.
+///
+/// Dictionaries are given per message type. A dictionary is used for the
+/// messages of its type, or for the `messages::Datagram`s holding a payload of
+/// its type, as soon as the remote says it has the same dictionary.
+///
+/// Dictionaries must be added at startup, before any socket opens.
+class CompressionDictionaries {
+public:
+
+	// MARK: - Singleton
+
+	/// Singleton accessor
+	static CompressionDictionaries * instance() {
+		if(_instance == nullptr)
+			_instance = new CompressionDictionaries();
+
+		return _instance;
+	}
+
+	// MARK: - Dictionaries
+
+	/// Adds a dictionary for the given message type
+	/// @param typeID Id of the message type, in the `MessageRegistry`
+	/// @param data The dictionary content, trained using `train()` or the zstd CLI
+	/// @param level Compression level used with the dictionary by zstd
+	void add(const MessageRegistry::TypeID &typeID, const std::string &data, const int &level = 3);
+
+	/// Gives the dictionary of the given message type
+	/// @return The dictionary, or nullptr if there is none for this type
+	const CompressionDictionary * get(const MessageRegistry::TypeID &typeID) const;
+
+	/// Gives the type of the given message, as used to select a dictionary
+	static MessageRegistry::TypeID typeOf(const protobuf::Message * message);
+
+	/// Trains a dictionary from samples of serialized messages of the same type
+	/// @param samples Serialized messages. A few thousands are recommended
+	/// @param capacity Maximum size of the dictionary
+	/// @return The dictionary, or an empty string if the training failed
+	static std::string train(const std::vector<std::string> &samples, const std::size_t &capacity = 16384);
+
+private:
+
+	CompressionDictionaries() = default;
+
+	// The compressors announce the dictionaries to the remotes
+	friend class Compressor;
+
+	/// The singleton instance
+	static CompressionDictionaries * _instance;
+
+	/// The dictionaries, by message type
+	std::unordered_map<MessageRegistry::TypeID, std::unique_ptr<CompressionDictionary>> _dictionaries;
+};
+
+/// Builds and reads the frames of the `compressed` format. Holds the
+/// compression contexts of a single socket, and is not thread-safe, except
+/// for the remote dictionaries.
+///
+/// Each frame is prefixed by its size as a varint, followed by the type of the
+/// frame. The content of a frame is a sequence of framed messages, as with
+/// `SocketFormat::protobufFramed`.
+///
+/// - Uncompressed frames: `size | 0 | messages`
+/// - Compressed frames: `size | codec | messages size | dictionary type | compressed messages`
+/// - Hello frames, sent by both sides when the connection opens, listing the
+///   dictionaries they have: `size | 0x7F | count | (type, hash) * count`
+class Compressor {
+public:
+
+	Compressor();
+
+	~Compressor();
+
+	/// Type of the hello frame
+	static constexpr uint8_t helloFrame = 0x7F;
+
+	/// Default size under which messages are not compressed
+	static constexpr std::size_t defaultThreshold = 256;
+
+	/// Size of the decompression buffer kept between two frames
+	static constexpr std::size_t retainedBufferSize = 65536;
+
+	// MARK: - Emission
+
+	/// Appends a frame holding the given framed messages to the given string.
+	/// The messages are compressed if they are large enough and it is worth it.
+	/// @param messages The framed messages
+	/// @param size Size of the messages
+	/// @param codec The compression codec to use
+	/// @param level Compression level, used by zstd without dictionary
+	/// @param threshold Size under which the messages are not compressed
+	/// @param dictionary The dictionary to use, if any
+	/// @param output The receiving string
+	void appendFrame(const char * messages, const std::size_t &size, const CompressionCodec &codec, const int &level, const std::size_t &threshold, const CompressionDictionary * dictionary, std::string &output);
+
+	/// Appends the header of an uncompressed frame holding messages of the given size
+	static void appendUncompressedHeader(const std::size_t &size, std::string &output);
+
+	/// Appends a hello frame listing the local dictionaries to the given string
+	static void appendHello(std::string &output);
+
+	// MARK: - Reception
+
+	/// Reads the given frame.
+	/// @param frame The frame content, after its size prefix
+	/// @param size Size of the frame content
+	/// @param maxSize Size in bytes of the largest decompressed messages accepted
+	/// @param messages Receives the address of the framed messages. Decompressed
+	/// messages are held by the compressor until the next frame is read, or
+	/// `releaseFrame` is called
+	/// @param messagesSize Receives the size of the messages
+	/// @return False if the frame is invalid, or its messages too large
+	bool readFrame(const char * frame, const std::size_t &size, const std::size_t &maxSize, const char * &messages, std::size_t &messagesSize);
+
+	/// Releases the messages of the last read frame. The memory of a large
+	/// frame is given back.
+	void releaseFrame();
+
+	/// Gives the local dictionary to use for the given message type, if the remote has the same one
+	const CompressionDictionary * remoteDictionary(const MessageRegistry::TypeID &typeID);
+
+	/// Gives the number of bytes of buffer memory held by the compressor
+	std::size_t getBufferMemory() const;
+
+private:
+
+	/// Reads a hello frame content, and records the dictionaries of the remote
+	bool readHello(const char * data, const std::size_t &size);
+
+	ZSTD_CCtx_s * _zstdCompression = nullptr;
+
+	ZSTD_DCtx_s * _zstdDecompression = nullptr;
+
+	LZ4_stream_u * _lz4Stream = nullptr;
+
+	/// Compressed messages, before they are appended to a frame
+	std::string _compressionBuffer;
+
+	/// Decompressed messages of the last read frame
+	std::string _decompressionBuffer;
+
+	/// Hash of each dictionary of the remote, by message type
+	std::unordered_map<MessageRegistry::TypeID, uint32_t> _remoteDictionaries;
+
+	std::mutex _remoteDictionariesMutex;
+};
+
+} /* ::network */
+
+#endif /* Compressor_hpp */
@@ -0,0 +1,91 @@
+//
+//  FailureDetector.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "FailureDetector.hpp"
+
+namespace network {
+
+void FailureDetector::heartbeat(const int64_t &time) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(_lastArrival != 0 && time > _lastArrival) {
+		const int64_t interval = time - _lastArrival;
+
+		// The oldest interval leaves the sums as the new one comes in
+		if(_count == sampleCount) {
+			const double oldest = _intervals[_next];
+			_sum -= oldest;
+			_squaredSum -= oldest * oldest;
+		} else {
+			++_count;
+		}
+
+		_intervals[_next] = interval;
+		_next = (_next + 1) % sampleCount;
+
+		_sum += interval;
+		_squaredSum += (double)interval * interval;
+	}
+
+	_lastArrival = std::max(_lastArrival, time);
+}
+
+void FailureDetector::reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_count = 0;
+	_next = 0;
+	_sum = _squaredSum = 0;
+	_lastArrival = 0;
+}
+
+double FailureDetector::getPhi(const int64_t &time) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(_lastArrival == 0 || time <= _lastArrival)
+		return 0;
+
+	const double measured = _count == 0 ? 0 : _sum / _count;
+	const double mean = std::max(measured, (double)_minimumInterval);
+
+	if(mean <= 0)
+		return 0;
+
+	const double variance = _count == 0 ? 0 : std::max(_squaredSum / _count - measured * measured, 0.0);
+	const double deviation = std::max(std::sqrt(variance), mean * minDeviation);
+
+	// Probability of a reception coming later than now
+	const double elapsed = time - _lastArrival;
+	const double later = 0.5 * std::erfc((elapsed - mean) / (deviation * std::sqrt(2.0)));
+
+	if(later <= std::numeric_limits<double>::min())
+		return std::numeric_limits<double>::infinity();
+
+	return -std::log10(later);
+}
+
+int64_t FailureDetector::getLastArrival() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _lastArrival;
+}
+
+int64_t FailureDetector::getMeanInterval() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _count == 0 ? 0 : (int64_t)(_sum / _count);
+}
+
+void FailureDetector::setMinimumInterval(const int64_t &interval) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_minimumInterval = interval;
+}
+
+} /* ::network */
@@ -0,0 +1,85 @@
+//
+//  FailureDetector.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef FailureDetector_hpp
+#define FailureDetector_hpp
+
+#include <cstdint>
+#include <mutex>
+
+namespace network {
+
+/// A phi-accrual failure detector, telling how likely it is that a remote is
+/// gone from the time elapsed since anything was last received from it.
+///
+/// The intervals between receptions are modelled with a normal distribution.
+/// Phi is the negated base 10 logarithm of the probability that a reception
+/// comes even later than now: a phi of 1 means a 10% chance of being wrong by
+/// considering the remote gone, a phi of 3 a 0.1% chance.
+///
+/// As bursts of messages would make the expected interval very short, the
+/// interval is never considered shorter than the minimum interval, usually the
+/// heartbeat of the connection. Times are in nanoseconds. The detector can be
+/// used from any thread.
+class FailureDetector {
+public:
+
+	/// Records the reception of something from the remote
+	/// @param time The time of the reception
+	void heartbeat(const int64_t &time);
+
+	/// Forgets all the receptions
+	void reset();
+
+	/// Gives the suspicion level of the remote at the given time. Phi is zero
+	/// until an interval is known, either measured or minimum.
+	/// @param time The current time
+	double getPhi(const int64_t &time);
+
+	/// Gives the time of the last reception, zero if none
+	int64_t getLastArrival();
+
+	/// Gives the average interval between two receptions
+	int64_t getMeanInterval();
+
+	/// Sets the shortest interval expected between two receptions
+	/// @param interval An interval in nanoseconds
+	void setMinimumInterval(const int64_t &interval);
+
+private:
+
+	/// Number of intervals the distribution is computed on
+	static constexpr unsigned int sampleCount = 128;
+
+	/// The standard deviation is never considered under this part of the mean,
+	/// keeping regular intervals from making phi climb right after the mean
+	static constexpr double minDeviation = 0.25;
+
+	std::mutex _mutex;
+
+	/// The latest intervals, in a ring
+	int64_t _intervals[sampleCount] = {};
+
+	unsigned int _count = 0;
+
+	/// Position of the next interval in the ring
+	unsigned int _next = 0;
+
+	/// Sums of the intervals and of their squares, kept along with the ring
+	double _sum = 0;
+
+	double _squaredSum = 0;
+
+	int64_t _lastArrival = 0;
+
+	int64_t _minimumInterval = 0;
+};
+
+} /* ::network */
+
+#endif /* FailureDetector_hpp */
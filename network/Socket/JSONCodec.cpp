@@ -0,0 +1,851 @@
+//
+//  JSONCodec.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-10.
+//
+
+#include "JSONCodec.hpp"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <google/protobuf/io/strtod.h>
+#include <google/protobuf/stubs/strutil.h>
+#include <google/protobuf/util/json_util.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace network {
+
+/// Tell if the given byte cannot be copied as-is in or out of a JSON string.
+/// Quotes, backslashes, control and non-ASCII characters are special. When
+/// printing, `<`, `>` and DEL are special as well, as protobuf escapes them.
+static inline bool isSpecial(const unsigned char &c, const bool &forOutput) {
+	if(c < 0x20 || c >= 0x80 || c == '"' || c == '\\')
+		return true;
+
+	return forOutput && (c == '<' || c == '>' || c == 0x7F);
+}
+
+/// Gives the first special byte of the given range, or `end`.
+/// Looks at 16 bytes per iteration using SIMD instructions when available.
+static const char * scanString(const char * data, const char * end, const bool &forOutput) {
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(0x20);
+	const __m128i lower = _mm_set1_epi8('<');
+	const __m128i greater = _mm_set1_epi8('>');
+	const __m128i del = _mm_set1_epi8(0x7F);
+
+	for(; end - data >= 16; data += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+
+		// Using a signed comparison, bytes above 0x7F are below 0x20 as well
+		__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), _mm_cmplt_epi8(chunk, space));
+
+		if(forOutput)
+			special = _mm_or_si128(special, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, lower), _mm_cmpeq_epi8(chunk, greater)), _mm_cmpeq_epi8(chunk, del)));
+
+		const int mask = _mm_movemask_epi8(special);
+
+		if(mask != 0)
+			return data + __builtin_ctz(mask);
+	}
+#elif defined(__aarch64__)
+	const int8x16_t quote = vdupq_n_s8('"');
+	const int8x16_t backslash = vdupq_n_s8('\\');
+	const int8x16_t space = vdupq_n_s8(0x20);
+	const int8x16_t lower = vdupq_n_s8('<');
+	const int8x16_t greater = vdupq_n_s8('>');
+	const int8x16_t del = vdupq_n_s8(0x7F);
+
+	for(; end - data >= 16; data += 16) {
+		const int8x16_t chunk = vld1q_s8(reinterpret_cast<const int8_t *>(data));
+
+		// Using a signed comparison, bytes above 0x7F are below 0x20 as well
+		uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_s8(chunk, quote), vceqq_s8(chunk, backslash)), vcltq_s8(chunk, space));
+
+		if(forOutput)
+			special = vorrq_u8(special, vorrq_u8(vorrq_u8(vceqq_s8(chunk, lower), vceqq_s8(chunk, greater)), vceqq_s8(chunk, del)));
+
+		// Find the special byte in the 16 bytes
+		if(vmaxvq_u8(special) != 0)
+			break;
+	}
+#endif
+
+	// Remaining bytes
+	for(; data < end; ++data) {
+		if(isSpecial((unsigned char)*data, forOutput))
+			return data;
+	}
+
+	return end;
+}
+
+/// Appends the given string, quoted and escaped like protobuf does
+/// @return False if the string holds non-ASCII characters
+static bool appendString(const std::string &value, std::string &output) {
+	static const char hex[] = "0123456789abcdef";
+
+	const char * data = value.data();
+	const char * end = data + value.size();
+
+	output += '"';
+
+	while(true) {
+		const char * special = scanString(data, end, true);
+		output.append(data, special - data);
+
+		if(special == end)
+			break;
+
+		const unsigned char c = (unsigned char)*special;
+
+		switch(c) {
+			case '"': output += "\\\""; break;
+			case '\\': output += "\\\\"; break;
+			case '\b': output += "\\b"; break;
+			case '\t': output += "\\t"; break;
+			case '\n': output += "\\n"; break;
+			case '\f': output += "\\f"; break;
+			case '\r': output += "\\r"; break;
+			default:
+				// Escaping of multi-byte characters is left to protobuf
+				if(c >= 0x80)
+					return false;
+
+				const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+				output.append(escape, sizeof(escape));
+				break;
+		}
+
+		data = special + 1;
+	}
+
+	output += '"';
+	return true;
+}
+
+/// Appends the given floating point value like protobuf does
+template<typename Float>
+static void appendFloat(const Float &value, std::string &output) {
+	if(std::isnan(value))
+		output += "\"NaN\"";
+	else if(std::isinf(value))
+		output += value > 0 ? "\"Infinity\"" : "\"-Infinity\"";
+	else
+		output += sizeof(Float) == sizeof(float) ? protobuf::SimpleFtoa((float)value) : protobuf::SimpleDtoa((double)value);
+}
+
+/// Tell if the given message type is a well-known type, printed in a special way
+static inline bool isWellKnownType(const std::string &fullName) {
+	return fullName.compare(0, 16, "google.protobuf.") == 0;
+}
+
+JSONCodec * JSONCodec::_instance = nullptr;
+
+// MARK: - Field tables
+
+const JSONCodec::MessageTable & JSONCodec::table(const protobuf::Descriptor * descriptor) {
+	std::lock_guard<std::mutex> lock(_tablesMutex);
+
+	std::unique_ptr<MessageTable> &messageTable = _tables[descriptor];
+
+	if(messageTable)
+		return *messageTable;
+
+	messageTable.reset(new MessageTable());
+	messageTable->isSupported = !isWellKnownType(descriptor->full_name());
+	messageTable->keys.resize(descriptor->field_count());
+
+	for(int i = 0; i < descriptor->field_count(); ++i) {
+		const protobuf::FieldDescriptor * field = descriptor->field(i);
+
+		// Names needing escaping are left to protobuf
+		for(const char &c: field->json_name()) {
+			if(isSpecial((unsigned char)c, true))
+				messageTable->isSupported = false;
+		}
+
+		messageTable->keys[i] = "\"" + field->json_name() + "\":";
+		messageTable->fields[field->json_name()] = field;
+		messageTable->fields[field->name()] = field;
+	}
+
+	return *messageTable;
+}
+
+// MARK: - Encoding
+
+void JSONCodec::encode(const protobuf::Message &message, std::string &output) {
+	const std::size_t offset = output.size();
+
+	if(encodeMessage(message, output))
+		return;
+
+	// Let protobuf print the messages the codec does not handle
+	output.resize(offset);
+
+	std::string fallback;
+	protobuf::util::MessageToJsonString(message, &fallback);
+
+	output += fallback;
+}
+
+bool JSONCodec::encodeMessage(const protobuf::Message &message, std::string &output) {
+	const MessageTable &messageTable = table(message.GetDescriptor());
+
+	if(!messageTable.isSupported)
+		return false;
+
+	const protobuf::Reflection * reflection = message.GetReflection();
+
+	// Only the fields that are set are printed, in field number order
+	std::vector<const protobuf::FieldDescriptor *> fields;
+	reflection->ListFields(message, &fields);
+
+	output += '{';
+
+	for(std::size_t i = 0; i < fields.size(); ++i) {
+		const protobuf::FieldDescriptor * field = fields[i];
+
+		if(field->is_extension() || field->is_map())
+			return false;
+
+		if(i > 0)
+			output += ',';
+
+		output += messageTable.keys[field->index()];
+
+		if(!field->is_repeated()) {
+			if(!encodeValue(message, field, 0, output))
+				return false;
+
+			continue;
+		}
+
+		output += '[';
+
+		const int count = reflection->FieldSize(message, field);
+
+		for(int j = 0; j < count; ++j) {
+			if(j > 0)
+				output += ',';
+
+			if(!encodeValue(message, field, j, output))
+				return false;
+		}
+
+		output += ']';
+	}
+
+	output += '}';
+	return true;
+}
+
+bool JSONCodec::encodeValue(const protobuf::Message &message, const protobuf::FieldDescriptor * field, const int &index, std::string &output) {
+	const protobuf::Reflection * reflection = message.GetReflection();
+	const bool repeated = field->is_repeated();
+
+	char digits[32];
+
+	switch(field->cpp_type()) {
+		case protobuf::FieldDescriptor::CPPTYPE_INT32: {
+			const int32_t value = repeated ? reflection->GetRepeatedInt32(message, field, index) : reflection->GetInt32(message, field);
+			output.append(digits, protobuf::FastInt32ToBufferLeft(value, digits) - digits);
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_UINT32: {
+			const uint32_t value = repeated ? reflection->GetRepeatedUInt32(message, field, index) : reflection->GetUInt32(message, field);
+			output.append(digits, protobuf::FastUInt32ToBufferLeft(value, digits) - digits);
+		} break;
+
+		// 64 bits integers are printed as strings
+		case protobuf::FieldDescriptor::CPPTYPE_INT64: {
+			const int64_t value = repeated ? reflection->GetRepeatedInt64(message, field, index) : reflection->GetInt64(message, field);
+			output += '"';
+			output.append(digits, protobuf::FastInt64ToBufferLeft(value, digits) - digits);
+			output += '"';
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_UINT64: {
+			const uint64_t value = repeated ? reflection->GetRepeatedUInt64(message, field, index) : reflection->GetUInt64(message, field);
+			output += '"';
+			output.append(digits, protobuf::FastUInt64ToBufferLeft(value, digits) - digits);
+			output += '"';
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+			appendFloat(repeated ? reflection->GetRepeatedFloat(message, field, index) : reflection->GetFloat(message, field), output);
+			break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+			appendFloat(repeated ? reflection->GetRepeatedDouble(message, field, index) : reflection->GetDouble(message, field), output);
+			break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_BOOL: {
+			const bool value = repeated ? reflection->GetRepeatedBool(message, field, index) : reflection->GetBool(message, field);
+			output += value ? "true" : "false";
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_ENUM: {
+			// NullValue is printed as null
+			if(isWellKnownType(field->enum_type()->full_name()))
+				return false;
+
+			const int number = repeated ? reflection->GetRepeatedEnumValue(message, field, index) : reflection->GetEnumValue(message, field);
+			const protobuf::EnumValueDescriptor * value = field->enum_type()->FindValueByNumber(number);
+
+			// Unknown values are printed as numbers
+			if(value == nullptr) {
+				output.append(digits, protobuf::FastInt32ToBufferLeft(number, digits) - digits);
+				break;
+			}
+
+			output += '"';
+			output += value->name();
+			output += '"';
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_STRING: {
+			std::string scratch;
+			const std::string &value = repeated ? reflection->GetRepeatedStringReference(message, field, index, &scratch) : reflection->GetStringReference(message, field, &scratch);
+
+			if(field->type() != protobuf::FieldDescriptor::TYPE_BYTES)
+				return appendString(value, output);
+
+			// Bytes are printed in base64, in place
+			const std::size_t offset = output.size();
+			const int size = protobuf::CalculateBase64EscapedLen((int)value.size(), true);
+
+			output.resize(offset + size + 2);
+			output[offset] = '"';
+
+			const int written = protobuf::Base64Escape(reinterpret_cast<const unsigned char *>(value.data()), (int)value.size(), &output[offset + 1], size);
+
+			output.resize(offset + 1 + written);
+			output += '"';
+		} break;
+
+		case protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+			return encodeMessage(repeated ? reflection->GetRepeatedMessage(message, field, index) : reflection->GetMessage(message, field), output);
+	}
+
+	return true;
+}
+
+// MARK: - Decoding
+
+/// A recursive descent parser filling a message from its JSON representation.
+///
+/// It handles the JSON printed by the codec and by protobuf. Anything else
+/// makes it fail, and is then given to protobuf.
+class JSONCodec::Parser {
+public:
+	Parser(JSONCodec &codec, const char * text, const std::size_t &size):
+	_codec(codec),
+	_cursor(text),
+	_end(text + size) {}
+
+	/// Parses the whole text in the given message
+	bool parse(protobuf::Message * message) {
+		if(!parseMessage(message))
+			return false;
+
+		skipWhitespace();
+		return _cursor == _end;
+	}
+
+private:
+	JSONCodec &_codec;
+
+	const char * _cursor;
+
+	const char * _end;
+
+	/// Reused to hold parsed keys and strings
+	std::string _key;
+	std::string _string;
+	std::string _bytes;
+
+	// MARK: - Tokens
+
+	inline void skipWhitespace() {
+		while(_cursor < _end && (*_cursor == ' ' || *_cursor == '\n' || *_cursor == '\r' || *_cursor == '\t'))
+			++_cursor;
+	}
+
+	/// Tell if the next token starts with the given character
+	inline bool peek(const char &c) {
+		skipWhitespace();
+		return _cursor < _end && *_cursor == c;
+	}
+
+	/// Consumes the given character if it is the next token
+	inline bool consume(const char &c) {
+		if(!peek(c))
+			return false;
+
+		++_cursor;
+		return true;
+	}
+
+	/// Consumes the given literal if it is the next token
+	inline bool consume(const char * literal, const std::size_t &size) {
+		skipWhitespace();
+
+		if((std::size_t)(_end - _cursor) < size || std::memcmp(_cursor, literal, size) != 0)
+			return false;
+
+		_cursor += size;
+		return true;
+	}
+
+	bool parseHex(uint32_t &value) {
+		if(_end - _cursor < 4)
+			return false;
+
+		value = 0;
+
+		for(int i = 0; i < 4; ++i) {
+			const char c = *_cursor++;
+			value <<= 4;
+
+			if(c >= '0' && c <= '9')
+				value |= c - '0';
+			else if(c >= 'a' && c <= 'f')
+				value |= c - 'a' + 10;
+			else if(c >= 'A' && c <= 'F')
+				value |= c - 'A' + 10;
+			else
+				return false;
+		}
+
+		return true;
+	}
+
+	bool parseString(std::string &output) {
+		if(!consume('"'))
+			return false;
+
+		output.clear();
+
+		while(true) {
+			const char * special = scanString(_cursor, _end, false);
+			output.append(_cursor, special - _cursor);
+			_cursor = special;
+
+			if(_cursor == _end)
+				return false;
+
+			const char c = *_cursor++;
+
+			if(c == '"')
+				return true;
+
+			// Raw control and non-ASCII characters are left to protobuf
+			if(c != '\\' || _cursor == _end)
+				return false;
+
+			uint32_t codePoint;
+
+			switch(*_cursor++) {
+				case '"': output += '"'; continue;
+				case '\\': output += '\\'; continue;
+				case '/': output += '/'; continue;
+				case 'b': output += '\b'; continue;
+				case 'f': output += '\f'; continue;
+				case 'n': output += '\n'; continue;
+				case 'r': output += '\r'; continue;
+				case 't': output += '\t'; continue;
+				case 'u':
+					if(!parseHex(codePoint))
+						return false;
+					break;
+				default:
+					return false;
+			}
+
+			// Surrogate pairs
+			if(codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+				return false;
+
+			if(codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+				uint32_t low;
+
+				if(!consume("\\u", 2) || !parseHex(low) || low < 0xDC00 || low > 0xDFFF)
+					return false;
+
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+			}
+
+			// Encode in UTF-8
+			if(codePoint < 0x80) {
+				output += (char)codePoint;
+			} else if(codePoint < 0x800) {
+				output += (char)(0xC0 | (codePoint >> 6));
+				output += (char)(0x80 | (codePoint & 0x3F));
+			} else if(codePoint < 0x10000) {
+				output += (char)(0xE0 | (codePoint >> 12));
+				output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				output += (char)(0x80 | (codePoint & 0x3F));
+			} else {
+				output += (char)(0xF0 | (codePoint >> 18));
+				output += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+				output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				output += (char)(0x80 | (codePoint & 0x3F));
+			}
+		}
+	}
+
+	/// Parses an integer, written as a number or as a string
+	bool parseInteger(bool &negative, uint64_t &magnitude) {
+		const bool quoted = consume('"');
+
+		negative = _cursor < _end && *_cursor == '-';
+
+		if(negative)
+			++_cursor;
+
+		const char * digits = _cursor;
+		magnitude = 0;
+
+		for(; _cursor < _end && *_cursor >= '0' && *_cursor <= '9'; ++_cursor) {
+			const uint64_t digit = *_cursor - '0';
+
+			if(magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+				return false;
+
+			magnitude = magnitude * 10 + digit;
+		}
+
+		// Leading zeros, fractions and exponents are left to protobuf
+		if(_cursor == digits || (*digits == '0' && _cursor - digits > 1))
+			return false;
+
+		if(_cursor < _end && (*_cursor == '.' || *_cursor == 'e' || *_cursor == 'E'))
+			return false;
+
+		return !quoted || (_cursor < _end && *_cursor++ == '"');
+	}
+
+	bool parseSigned(int64_t &value, const int64_t &max) {
+		bool negative;
+		uint64_t magnitude;
+
+		if(!parseInteger(negative, magnitude))
+			return false;
+
+		// The smallest value is -(max + 1)
+		if(negative) {
+			if(magnitude > (uint64_t)max + 1)
+				return false;
+
+			value = magnitude == 0 ? 0 : -(int64_t)(magnitude - 1) - 1;
+			return true;
+		}
+
+		if(magnitude > (uint64_t)max)
+			return false;
+
+		value = (int64_t)magnitude;
+		return true;
+	}
+
+	bool parseUnsigned(uint64_t &value, const uint64_t &max) {
+		bool negative;
+
+		if(!parseInteger(negative, value))
+			return false;
+
+		return (!negative || value == 0) && value <= max;
+	}
+
+	/// Parses a floating point value, written as a number or as a string
+	bool parseDouble(double &value) {
+		skipWhitespace();
+
+		if(peek('"')) {
+			if(consume("\"NaN\"", 5)) {
+				value = std::numeric_limits<double>::quiet_NaN();
+				return true;
+			}
+
+			if(consume("\"Infinity\"", 10)) {
+				value = std::numeric_limits<double>::infinity();
+				return true;
+			}
+
+			if(consume("\"-Infinity\"", 11)) {
+				value = -std::numeric_limits<double>::infinity();
+				return true;
+			}
+
+			return false;
+		}
+
+		// -?int(.digits)?([eE][+-]?digits)?
+		const char * start = _cursor;
+
+		if(_cursor < _end && *_cursor == '-')
+			++_cursor;
+
+		const char * digits = _cursor;
+
+		while(_cursor < _end && *_cursor >= '0' && *_cursor <= '9')
+			++_cursor;
+
+		if(_cursor == digits || (*digits == '0' && _cursor - digits > 1))
+			return false;
+
+		bool isInteger = true;
+
+		if(_cursor < _end && *_cursor == '.') {
+			isInteger = false;
+			digits = ++_cursor;
+
+			while(_cursor < _end && *_cursor >= '0' && *_cursor <= '9')
+				++_cursor;
+
+			if(_cursor == digits)
+				return false;
+		}
+
+		if(_cursor < _end && (*_cursor == 'e' || *_cursor == 'E')) {
+			isInteger = false;
+			++_cursor;
+
+			if(_cursor < _end && (*_cursor == '+' || *_cursor == '-'))
+				++_cursor;
+
+			digits = _cursor;
+
+			while(_cursor < _end && *_cursor >= '0' && *_cursor <= '9')
+				++_cursor;
+
+			if(_cursor == digits)
+				return false;
+		}
+
+		// The text is not null-terminated
+		char number[64];
+		const std::size_t size = _cursor - start;
+
+		if(size >= sizeof(number))
+			return false;
+
+		std::memcpy(number, start, size);
+		number[size] = '\0';
+
+		char * numberEnd;
+		value = protobuf::io::NoLocaleStrtod(number, &numberEnd);
+
+		// Like protobuf, read -0 as an integer
+		if(isInteger && value == 0)
+			value = 0;
+
+		return numberEnd == number + size && !std::isinf(value);
+	}
+
+	// MARK: - Values
+
+	bool parseMessage(protobuf::Message * message) {
+		const MessageTable &messageTable = _codec.table(message->GetDescriptor());
+
+		if(!messageTable.isSupported || !consume('{'))
+			return false;
+
+		if(consume('}'))
+			return true;
+
+		const protobuf::Reflection * reflection = message->GetReflection();
+
+		do {
+			if(!parseString(_key) || !consume(':'))
+				return false;
+
+			auto it = messageTable.fields.find(_key);
+
+			if(it == messageTable.fields.end())
+				return false;
+
+			const protobuf::FieldDescriptor * field = it->second;
+
+			if(field->is_map())
+				return false;
+
+			// Well-known types give a meaning to null
+			if(field->cpp_type() == protobuf::FieldDescriptor::CPPTYPE_MESSAGE && !_codec.table(field->message_type()).isSupported)
+				return false;
+
+			if(field->cpp_type() == protobuf::FieldDescriptor::CPPTYPE_ENUM && isWellKnownType(field->enum_type()->full_name()))
+				return false;
+
+			// Null leaves the default value
+			if(consume("null", 4))
+				continue;
+
+			if(!field->is_repeated()) {
+				// Fields given twice are left to protobuf
+				if(reflection->HasField(*message, field) || (field->containing_oneof() && reflection->HasOneof(*message, field->containing_oneof())))
+					return false;
+
+				if(!parseValue(message, field))
+					return false;
+
+				continue;
+			}
+
+			if(!consume('['))
+				return false;
+
+			if(consume(']'))
+				continue;
+
+			do {
+				if(!parseValue(message, field))
+					return false;
+			} while(consume(','));
+
+			if(!consume(']'))
+				return false;
+		} while(consume(','));
+
+		return consume('}');
+	}
+
+	/// Parses the value of the given field. Repeated fields get a new element.
+	bool parseValue(protobuf::Message * message, const protobuf::FieldDescriptor * field) {
+		const protobuf::Reflection * reflection = message->GetReflection();
+		const bool repeated = field->is_repeated();
+
+		int64_t signedValue;
+		uint64_t unsignedValue;
+		double doubleValue;
+
+		switch(field->cpp_type()) {
+			case protobuf::FieldDescriptor::CPPTYPE_INT32:
+				if(!parseSigned(signedValue, std::numeric_limits<int32_t>::max()))
+					return false;
+
+				repeated ? reflection->AddInt32(message, field, (int32_t)signedValue) : reflection->SetInt32(message, field, (int32_t)signedValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_INT64:
+				if(!parseSigned(signedValue, std::numeric_limits<int64_t>::max()))
+					return false;
+
+				repeated ? reflection->AddInt64(message, field, signedValue) : reflection->SetInt64(message, field, signedValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_UINT32:
+				if(!parseUnsigned(unsignedValue, std::numeric_limits<uint32_t>::max()))
+					return false;
+
+				repeated ? reflection->AddUInt32(message, field, (uint32_t)unsignedValue) : reflection->SetUInt32(message, field, (uint32_t)unsignedValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_UINT64:
+				if(!parseUnsigned(unsignedValue, std::numeric_limits<uint64_t>::max()))
+					return false;
+
+				repeated ? reflection->AddUInt64(message, field, unsignedValue) : reflection->SetUInt64(message, field, unsignedValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+				if(!parseDouble(doubleValue) || (std::isfinite(doubleValue) && std::fabs(doubleValue) > FLT_MAX))
+					return false;
+
+				repeated ? reflection->AddFloat(message, field, (float)doubleValue) : reflection->SetFloat(message, field, (float)doubleValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+				if(!parseDouble(doubleValue))
+					return false;
+
+				repeated ? reflection->AddDouble(message, field, doubleValue) : reflection->SetDouble(message, field, doubleValue);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_BOOL: {
+				bool value;
+
+				if(consume("true", 4))
+					value = true;
+				else if(consume("false", 5))
+					value = false;
+				else
+					return false;
+
+				repeated ? reflection->AddBool(message, field, value) : reflection->SetBool(message, field, value);
+			} return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_ENUM: {
+				const protobuf::EnumValueDescriptor * value;
+
+				// Enums are given by name or by number
+				if(peek('"')) {
+					if(!parseString(_string))
+						return false;
+
+					value = field->enum_type()->FindValueByName(_string);
+				} else {
+					if(!parseSigned(signedValue, std::numeric_limits<int32_t>::max()))
+						return false;
+
+					value = field->enum_type()->FindValueByNumber((int)signedValue);
+				}
+
+				if(value == nullptr)
+					return false;
+
+				repeated ? reflection->AddEnumValue(message, field, value->number()) : reflection->SetEnumValue(message, field, value->number());
+			} return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_STRING:
+				if(!parseString(_string))
+					return false;
+
+				if(field->type() == protobuf::FieldDescriptor::TYPE_BYTES) {
+					// Bytes are given in base64, standard or URL-safe
+					if(!protobuf::Base64Unescape(_string, &_bytes) && !protobuf::WebSafeBase64Unescape(_string, &_bytes))
+						return false;
+
+					_string.swap(_bytes);
+				}
+
+				repeated ? reflection->AddString(message, field, _string) : reflection->SetString(message, field, _string);
+				return true;
+
+			case protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+				return parseMessage(repeated ? reflection->AddMessage(message, field) : reflection->MutableMessage(message, field));
+		}
+
+		return false;
+	}
+};
+
+bool JSONCodec::decode(const char * text, const std::size_t &size, protobuf::Message * message) {
+	message->Clear();
+
+	Parser parser(*this, text, size);
+
+	if(parser.parse(message))
+		return true;
+
+	// Let protobuf parse the text the codec does not handle
+	message->Clear();
+
+	return protobuf::util::JsonStringToMessage(protobuf::StringPiece(text, size), message).ok();
+}
+
+} /* ::network */
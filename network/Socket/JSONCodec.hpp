@@ -0,0 +1,108 @@
+//
+//  JSONCodec.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-10.
+//
+
+#ifndef JSONCodec_hpp
+#define JSONCodec_hpp
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+namespace protobuf = google::protobuf;
+
+namespace network {
+
+/// Converts protobuf messages to and from JSON, for the `json` and `ndjson`
+/// socket formats.
+///
+/// The output is byte for byte the one of `protobuf::util::MessageToJsonString`
+/// with the default options, and the input is understood like with
+/// `protobuf::util::JsonStringToMessage`. The field names and types of each
+/// message type are looked up once and cached, output is appended to the
+/// caller's buffer, and strings are scanned using SIMD instructions when
+/// available.
+///
+/// Messages using maps or well-known types, strings with non-ASCII
+/// characters, and any input the codec does not handle itself are passed on to
+/// the protobuf utilities.
+class JSONCodec {
+public:
+
+	// MARK: - Singleton
+
+	/// Singleton accessor
+	static JSONCodec * instance() {
+		if(_instance == nullptr)
+			_instance = new JSONCodec();
+
+		return _instance;
+	}
+
+	// MARK: - Conversion
+
+	/// Appends the JSON representation of the given message to the given string
+	/// @param message The message to print
+	/// @param output The string to append to
+	void encode(const protobuf::Message &message, std::string &output);
+
+	/// Parses the given JSON text in the given message
+	/// @param text The JSON text
+	/// @param size Size of the text
+	/// @param message The message to fill. It is cleared first
+	/// @return False if the text is not a valid representation of the message
+	bool decode(const char * text, const std::size_t &size, protobuf::Message * message);
+
+private:
+
+	JSONCodec() = default;
+
+	/// The singleton instance of the codec
+	static JSONCodec * _instance;
+
+	// MARK: - Field tables
+
+	/// What the codec needs to know about a message type
+	struct MessageTable {
+		/// False if the message has to go through the protobuf utilities
+		bool isSupported = true;
+
+		/// Quoted JSON name of each field, followed by a colon, by field index
+		std::vector<std::string> keys;
+
+		/// Fields by JSON name and by original name
+		std::unordered_map<std::string, const protobuf::FieldDescriptor *> fields;
+	};
+
+	/// Gives the table of the given message type, building it on first use
+	const MessageTable & table(const protobuf::Descriptor * descriptor);
+
+	/// Field tables, by message type
+	std::unordered_map<const protobuf::Descriptor *, std::unique_ptr<MessageTable>> _tables;
+
+	std::mutex _tablesMutex;
+
+	// MARK: - Encoding
+
+	bool encodeMessage(const protobuf::Message &message, std::string &output);
+
+	/// Prints the value of the given field. `index` is ignored for singular fields.
+	bool encodeValue(const protobuf::Message &message, const protobuf::FieldDescriptor * field, const int &index, std::string &output);
+
+	// MARK: - Decoding
+
+	class Parser;
+};
+
+} /* ::network */
+
+#endif /* JSONCodec_hpp */
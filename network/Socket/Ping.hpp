@@ -8,60 +8,81 @@
 #ifndef Ping_hpp
 #define Ping_hpp
 
-#include <chrono>
+#include <algorithm>
+#include <cstdint>
 
 #include "../Messages/network.pb.h"
+#include "../Messages/MessageRegistry.hpp"
 
-using timeScale = std::chrono::milliseconds;
+#include "ClockEstimator.hpp"
 
 namespace network {
 
 class BaseSocket;
 
+/// Pings measure the round-trip time of a connection, and the offset of the
+/// clock of the remote. A ping carries the time it was sent at, on the
+/// monotonic clock of its sender. The remote sends it back, adding the times
+/// it received and answered it, on its own clock.
 class Ping {
 protected:
 	void ping(BaseSocket * socket) {
-		long long now = std::chrono::duration_cast<timeScale>(std::chrono::system_clock::now().time_since_epoch()).count();
-
 		messages::Ping ping;
-		ping.set_time(now);
-
-		protobuf::Any * data = new protobuf::Any();
-		data->PackFrom(ping);
+		ping.set_time(ClockEstimator::now());
 
-		messages::Datagram * datagram = new messages::Datagram();
-		datagram->set_type(datagramType::ping);
-		datagram->set_allocated_data(data);
+		messages::Datagram datagram;
+		datagram.set_type(datagramType::ping);
+		MessageRegistry::instance()->pack(ping, datagram);
 
 		LOG_DEBUG("Sending a ping to " + socket->getRemote().ip);
-		socket->send(datagram);
-
-		datagram->clear_data();
+		socket->send(std::move(datagram), controlLane);
 	}
 
-	void onPing(protobuf::Any * data, BaseSocket * socket) {
+	void onPing(messages::Datagram * ping, BaseSocket * socket) {
+		const int64_t received = ClockEstimator::now();
+
 		// Say we received a ping
 		LOG_DEBUG("Relaying a ping");
 
-		// Relay the ping to its sender directly
-		messages::Datagram * datagram = new messages::Datagram();
-		datagram->set_type(datagramType::pong);
-		datagram->set_allocated_data(new protobuf::Any(*data));
+		messages::Ping pong;
+		MessageRegistry::instance()->unpack(*ping, pong);
 
-		socket->send(datagram);
+		pong.set_received_time(received);
+		pong.set_replied_time(ClockEstimator::now());
 
-		datagram->clear_data();
+		// Relay the ping to its sender directly
+		messages::Datagram datagram;
+		datagram.set_type(datagramType::pong);
+		MessageRegistry::instance()->pack(pong, datagram);
+
+		socket->send(std::move(datagram), controlLane);
 	}
 
-	void onPong(protobuf::Any * data, BaseSocket * socket) {
-		long long now = std::chrono::duration_cast<timeScale>(std::chrono::system_clock::now().time_since_epoch()).count();
+	void onPong(messages::Datagram * datagram, BaseSocket * socket) {
+		const int64_t now = ClockEstimator::now();
 
 		messages::Ping pong;
-		data->UnpackTo(&pong);
+		MessageRegistry::instance()->unpack(*datagram, pong);
+
+		const int64_t sent = pong.time();
+
+		// Pongs answering pings of a previous run of the clock are ignored
+		if(sent == 0 || sent > now)
+			return;
+
+		int64_t rtt = now - sent;
+
+		// Remotes giving their timestamps have their processing time removed
+		if(pong.received_time() != 0 && pong.replied_time() >= pong.received_time()) {
+			rtt -= std::min<int64_t>(rtt, pong.replied_time() - pong.received_time());
+			socket->getClockEstimator().addSample(sent, pong.received_time(), pong.replied_time(), now);
+		}
+
+		socket->getRTTStatistics().record(rtt);
 
-		std::string duration = std::to_string((now - pong.time()));
+		std::string duration = std::to_string(rtt / 1000);
 
-		LOG_DEBUG("Ping-pong with " + socket->getRemote().ip + " in " + duration + "ms");
+		LOG_DEBUG("Ping-pong with " + socket->getRemote().ip + " in " + duration + "us");
 	}
 };
 
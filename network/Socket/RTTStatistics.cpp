@@ -0,0 +1,131 @@
+//
+//  RTTStatistics.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "RTTStatistics.hpp"
+
+namespace network {
+
+void RTTStatistics::record(const uint64_t &rtt) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(_count == 0) {
+		_min = _max = rtt;
+		_average = rtt;
+		_jitter = rtt / 2.0;
+	} else {
+		_min = std::min(_min, rtt);
+		_max = std::max(_max, rtt);
+
+		// Same gains as TCP (RFC 6298)
+		_jitter += (std::abs(rtt - _average) - _jitter) / 4;
+		_average += (rtt - _average) / 8;
+	}
+
+	_last = rtt;
+	++_count;
+	++_buckets[bucketOf(rtt)];
+}
+
+void RTTStatistics::reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_count = 0;
+	_last = _min = _max = 0;
+	_average = _jitter = 0;
+
+	std::fill(std::begin(_buckets), std::end(_buckets), 0);
+}
+
+uint64_t RTTStatistics::getCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _count;
+}
+
+uint64_t RTTStatistics::getLast() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _last;
+}
+
+uint64_t RTTStatistics::getMin() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _min;
+}
+
+uint64_t RTTStatistics::getMax() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _max;
+}
+
+uint64_t RTTStatistics::getAverage() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return (uint64_t)_average;
+}
+
+uint64_t RTTStatistics::getJitter() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return (uint64_t)_jitter;
+}
+
+uint64_t RTTStatistics::getPercentile(const double &percentile) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(_count == 0)
+		return 0;
+
+	// Rank of the measure looked for, starting at 1
+	const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * _count));
+	uint64_t seen = 0;
+
+	if(rank == _count)
+		return _max;
+
+	for(unsigned int bucket = 0; bucket < bucketCount; ++bucket) {
+		seen += _buckets[bucket];
+
+		// The bucket value is kept within the measured extremes
+		if(seen >= rank)
+			return std::min(std::max(valueOf(bucket), _min), _max);
+	}
+
+	return _max;
+}
+
+unsigned int RTTStatistics::bucketOf(const uint64_t &value) {
+	if(value < subBucketCount * 2)
+		return (unsigned int)value;
+
+	const uint64_t clamped = std::min<uint64_t>(value, (1ull << maxExponent) - 1);
+
+	// Position of the highest bit, and the bits following it
+	unsigned int exponent = 0;
+
+	while((clamped >> (exponent + 1)) != 0)
+		++exponent;
+
+	const unsigned int subBucket = (clamped >> (exponent - subBucketBits)) & (subBucketCount - 1);
+
+	return (exponent - subBucketBits + 1) * subBucketCount + subBucket;
+}
+
+uint64_t RTTStatistics::valueOf(const unsigned int &bucket) {
+	if(bucket < subBucketCount * 2)
+		return bucket;
+
+	const unsigned int exponent = bucket / subBucketCount + subBucketBits - 1;
+	const unsigned int subBucket = bucket % subBucketCount;
+
+	const uint64_t width = 1ull << (exponent - subBucketBits);
+
+	return ((subBucketCount + subBucket) * width) + width / 2;
+}
+
+} /* ::network */
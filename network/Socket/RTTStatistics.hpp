@@ -0,0 +1,93 @@
+//
+//  RTTStatistics.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef RTTStatistics_hpp
+#define RTTStatistics_hpp
+
+#include <cstdint>
+#include <mutex>
+
+namespace network {
+
+/// Round-trip time statistics of a connection, measured by its pings.
+///
+/// Keeps a smoothed average and a jitter, as TCP does, the extremes, and a
+/// log-linear histogram giving percentiles within 1/16th of their value.
+/// All times are in nanoseconds. Statistics can be read from any thread.
+class RTTStatistics {
+public:
+
+	/// Adds a round-trip time to the statistics
+	/// @param rtt A round-trip time
+	void record(const uint64_t &rtt);
+
+	/// Clears all the statistics
+	void reset();
+
+	/// Gives the number of round-trip times measured
+	uint64_t getCount();
+
+	/// Gives the last round-trip time measured
+	uint64_t getLast();
+
+	/// Gives the shortest round-trip time measured
+	uint64_t getMin();
+
+	/// Gives the longest round-trip time measured
+	uint64_t getMax();
+
+	/// Gives the exponentially weighted moving average of the round-trip
+	/// times, each new measure counting for 1/8th
+	uint64_t getAverage();
+
+	/// Gives the average deviation of the round-trip times from their
+	/// average, each new measure counting for 1/4th
+	uint64_t getJitter();
+
+	/// Gives the round-trip time under which the given part of the measures are
+	/// @param percentile The part of the measures, between 0 and 100
+	uint64_t getPercentile(const double &percentile);
+
+private:
+
+	/// Each power of two is split in 2^subBucketBits buckets
+	static constexpr unsigned int subBucketBits = 4;
+
+	static constexpr unsigned int subBucketCount = 1 << subBucketBits;
+
+	/// Values are clamped under 2^40 ns, about 18 minutes
+	static constexpr unsigned int maxExponent = 40;
+
+	static constexpr unsigned int bucketCount = (maxExponent - subBucketBits + 1) * subBucketCount;
+
+	std::mutex _mutex;
+
+	uint64_t _count = 0;
+
+	uint64_t _last = 0;
+
+	uint64_t _min = 0;
+
+	uint64_t _max = 0;
+
+	double _average = 0;
+
+	double _jitter = 0;
+
+	uint64_t _buckets[bucketCount] = {};
+
+	/// Gives the bucket of the given value
+	static unsigned int bucketOf(const uint64_t &value);
+
+	/// Gives the value in the middle of the given bucket
+	static uint64_t valueOf(const unsigned int &bucket);
+};
+
+} /* ::network */
+
+#endif /* RTTStatistics_hpp */
@@ -0,0 +1,259 @@
+//
+//  RingBuffer.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-02.
+//
+
+#include "RingBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace network {
+
+/// Gives the first occurrence of the given byte in the given memory, or nullptr.
+/// Looks at 64 bytes per iteration using SIMD instructions when available.
+static const char * scanForByte(const char * data, const std::size_t &size, const char &byte) {
+	std::size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i needle = _mm_set1_epi8(byte);
+
+	for(; i + 64 <= size; i += 64) {
+		const __m128i * chunk = reinterpret_cast<const __m128i *>(data + i);
+		__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(chunk + 0), needle);
+		__m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(chunk + 1), needle);
+		__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128(chunk + 2), needle);
+		__m128i d = _mm_cmpeq_epi8(_mm_loadu_si128(chunk + 3), needle);
+
+		if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) == 0)
+			continue;
+
+		// Find the match in the 64 bytes
+		uint64_t mask = (uint64_t)(uint16_t)_mm_movemask_epi8(a)
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(b) << 16
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(c) << 32
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(d) << 48;
+
+		return data + i + __builtin_ctzll(mask);
+	}
+#elif defined(__aarch64__)
+	const uint8x16_t needle = vdupq_n_u8((uint8_t)byte);
+
+	for(; i + 64 <= size; i += 64) {
+		const uint8_t * chunk = reinterpret_cast<const uint8_t *>(data + i);
+		uint8x16_t a = vceqq_u8(vld1q_u8(chunk + 0), needle);
+		uint8x16_t b = vceqq_u8(vld1q_u8(chunk + 16), needle);
+		uint8x16_t c = vceqq_u8(vld1q_u8(chunk + 32), needle);
+		uint8x16_t d = vceqq_u8(vld1q_u8(chunk + 48), needle);
+
+		if(vmaxvq_u8(vorrq_u8(vorrq_u8(a, b), vorrq_u8(c, d))) == 0)
+			continue;
+
+		// Find the match in the 64 bytes
+		return static_cast<const char *>(std::memchr(data + i, byte, 64));
+	}
+#endif
+
+	// Remaining bytes
+	return static_cast<const char *>(std::memchr(data + i, byte, size - i));
+}
+
+constexpr std::size_t RingBuffer::npos;
+
+RingBuffer::~RingBuffer() {
+	BufferPool::instance()->release(_storage);
+}
+
+// MARK: - Memory
+
+bool RingBuffer::reserve(const std::size_t &capacity) {
+	if(capacity <= _storage.capacity)
+		return true;
+
+	BufferPool::Buffer storage = BufferPool::instance()->acquire(capacity);
+
+	if(!storage.data)
+		return false;
+
+	// Move the readable data at the start of the new storage
+	peek(0, storage.data.get(), _size);
+
+	BufferPool::instance()->release(_storage);
+
+	_storage = std::move(storage);
+	_begin = 0;
+
+	return true;
+}
+
+void RingBuffer::release() {
+	if(!empty())
+		return;
+
+	BufferPool::instance()->release(_storage);
+	clear();
+}
+
+// MARK: - Writing
+
+std::array<asio::mutable_buffer, 2> RingBuffer::freeSegments() {
+	const std::size_t capacity = _storage.capacity;
+
+	if(capacity == 0)
+		return {{ asio::mutable_buffer(), asio::mutable_buffer() }};
+
+	const std::size_t end = (_begin + _size) % capacity;
+
+	// The free region is contiguous if the readable one wraps around
+	if(_begin + _size >= capacity) {
+		return {{
+			asio::buffer(_storage.data.get() + end, capacity - _size),
+			asio::mutable_buffer()
+		}};
+	}
+
+	return {{
+		asio::buffer(_storage.data.get() + end, capacity - end),
+		asio::buffer(_storage.data.get(), _begin)
+	}};
+}
+
+void RingBuffer::commit(const std::size_t &size) {
+	_size += std::min(size, freeSpace());
+}
+
+// MARK: - Reading
+
+std::size_t RingBuffer::peek(const std::size_t &offset, char * dst, const std::size_t &size) const {
+	if(offset >= _size)
+		return 0;
+
+	const std::size_t count = std::min(size, _size - offset);
+	const std::size_t start = (_begin + offset) % _storage.capacity;
+	const std::size_t head = std::min(count, _storage.capacity - start);
+
+	std::memcpy(dst, _storage.data.get() + start, head);
+	std::memcpy(dst + head, _storage.data.get(), count - head);
+
+	return count;
+}
+
+const char * RingBuffer::contiguous(const std::size_t &offset, const std::size_t &size, std::string &scratch) const {
+	const std::size_t start = (_begin + offset) % _storage.capacity;
+
+	if(start + size <= _storage.capacity)
+		return _storage.data.get() + start;
+
+	scratch.resize(size);
+	peek(offset, &scratch[0], size);
+
+	return scratch.data();
+}
+
+std::size_t RingBuffer::find(const char * pattern, const std::size_t &patternSize, const std::size_t &from) const {
+	if(patternSize == 0 || _size < patternSize)
+		return npos;
+
+	std::string candidate(patternSize, '\0');
+
+	for(std::size_t offset = from; offset + patternSize <= _size;) {
+		// Look for the first character of the pattern up to the end of the storage
+		const std::size_t start = (_begin + offset) % _storage.capacity;
+		const std::size_t span = std::min(_size - offset, _storage.capacity - start);
+
+		const char * match = scanForByte(_storage.data.get() + start, span, pattern[0]);
+
+		if(match == nullptr) {
+			offset += span;
+			continue;
+		}
+
+		offset += match - (_storage.data.get() + start);
+
+		if(offset + patternSize > _size)
+			return npos;
+
+		peek(offset, &candidate[0], patternSize);
+
+		if(std::memcmp(candidate.data(), pattern, patternSize) == 0)
+			return offset;
+
+		++offset;
+	}
+
+	return npos;
+}
+
+std::size_t RingBuffer::findByte(const char &byte, const std::size_t &from) const {
+	for(std::size_t offset = from; offset < _size;) {
+		// Look up to the end of the storage
+		const std::size_t start = (_begin + offset) % _storage.capacity;
+		const std::size_t span = std::min(_size - offset, _storage.capacity - start);
+
+		const char * match = scanForByte(_storage.data.get() + start, span, byte);
+
+		if(match != nullptr)
+			return offset + (match - (_storage.data.get() + start));
+
+		offset += span;
+	}
+
+	return npos;
+}
+
+void RingBuffer::consume(const std::size_t &size) {
+	if(size >= _size) {
+		clear();
+		return;
+	}
+
+	_begin = (_begin + size) % _storage.capacity;
+	_size -= size;
+}
+
+// MARK: - Input Stream
+
+RingBuffer::InputStream::InputStream(const RingBuffer &buffer, const std::size_t &offset, const std::size_t &size):
+_buffer(buffer),
+_offset(offset),
+_size(std::min(size, buffer.size() > offset ? buffer.size() - offset : 0)) {}
+
+bool RingBuffer::InputStream::Next(const void ** data, int * size) {
+	if(_position >= _size)
+		return false;
+
+	// Give out everything up to the end of the range or of the storage
+	const std::size_t capacity = _buffer._storage.capacity;
+	const std::size_t start = (_buffer._begin + _offset + _position) % capacity;
+	const std::size_t count = std::min(_size - _position, capacity - start);
+
+	*data = _buffer._storage.data.get() + start;
+	*size = (int)count;
+
+	_position += count;
+	return true;
+}
+
+void RingBuffer::InputStream::BackUp(int count) {
+	_position -= std::min((std::size_t)count, _position);
+}
+
+bool RingBuffer::InputStream::Skip(int count) {
+	if(_position + count > _size) {
+		_position = _size;
+		return false;
+	}
+
+	_position += count;
+	return true;
+}
+
+} /* ::network */
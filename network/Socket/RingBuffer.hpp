@@ -0,0 +1,165 @@
+//
+//  RingBuffer.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-02.
+//
+
+#ifndef RingBuffer_hpp
+#define RingBuffer_hpp
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include "BufferPool.hpp"
+
+namespace asio = boost::asio;
+namespace protobuf = google::protobuf;
+
+namespace network {
+
+/// A circular buffer used to receive data from the network.
+///
+/// Data is received directly in the free region of the buffer, and read back
+/// without copy using a `RingBuffer::InputStream`.
+///
+/// The buffer memory is borrowed from the `BufferPool`. A new ring buffer has no
+/// memory, it has to be reserved before receiving, and should be released as soon
+/// as the buffer is empty.
+class RingBuffer {
+public:
+
+	RingBuffer() = default;
+
+	~RingBuffer();
+
+	// MARK: - Memory
+
+	/// Makes sure the buffer can hold at least the given number of bytes. Readable
+	/// data is preserved.
+	/// @param capacity The number of bytes the buffer needs to hold
+	/// @return False if the pool could not provide a buffer this large
+	bool reserve(const std::size_t &capacity);
+
+	/// Gives back the buffer memory to the pool. Does nothing if the buffer is not empty.
+	void release();
+
+	// MARK: - Writing
+
+	/// Gives the free region of the buffer as up to two asio buffers, suitable
+	/// for a scatter read.
+	std::array<asio::mutable_buffer, 2> freeSegments();
+
+	/// Marks the given number of bytes as written at the end of the readable region
+	/// @param size Number of bytes received in the free segments
+	void commit(const std::size_t &size);
+
+	// MARK: - Reading
+
+	/// Copies bytes from the readable region without consuming them
+	/// @param offset Offset from the start of the readable region
+	/// @param dst The destination
+	/// @param size Number of bytes to copy
+	/// @return The number of bytes effectively copied
+	std::size_t peek(const std::size_t &offset, char * dst, const std::size_t &size) const;
+
+	/// Gives a pointer to a contiguous range of the readable region. If the range
+	/// wraps around the end of the storage, it is copied in the given scratch string.
+	/// @param offset Offset from the start of the readable region
+	/// @param size Size of the range
+	/// @param scratch Used to hold the range if it is not contiguous
+	const char * contiguous(const std::size_t &offset, const std::size_t &size, std::string &scratch) const;
+
+	/// Looks for the given pattern in the readable region
+	/// @param pattern The pattern to look for
+	/// @param patternSize Size of the pattern
+	/// @param from Offset from the start of the readable region at which to start looking
+	/// @return The offset of the pattern, or `npos` if it is not found
+	std::size_t find(const char * pattern, const std::size_t &patternSize, const std::size_t &from = 0) const;
+
+	/// Looks for the given byte in the readable region
+	/// @param byte The byte to look for
+	/// @param from Offset from the start of the readable region at which to start looking
+	/// @return The offset of the byte, or `npos` if it is not found
+	std::size_t findByte(const char &byte, const std::size_t &from = 0) const;
+
+	static constexpr std::size_t npos = std::size_t(-1);
+
+	/// Releases the given number of bytes at the start of the readable region
+	void consume(const std::size_t &size);
+
+	/// Empties the buffer
+	inline void clear() { _begin = 0; _size = 0; }
+
+	// MARK: - Getters
+
+	/// Number of readable bytes in the buffer
+	inline std::size_t size() const { return _size; }
+
+	/// Total number of bytes the buffer can hold
+	inline std::size_t capacity() const { return _storage.capacity; }
+
+	/// Number of bytes that can still be received
+	inline std::size_t freeSpace() const { return _storage.capacity - _size; }
+
+	inline bool empty() const { return _size == 0; }
+
+	inline bool full() const { return _size == _storage.capacity; }
+
+	// MARK: - Input Stream
+
+	/// A protobuf zero-copy input stream exposing a range of the readable region
+	/// of a `RingBuffer`. Messages can be parsed in place from it, even if they
+	/// wrap around the end of the storage.
+	///
+	/// The stream does not consume the data, and must not outlive modifications
+	/// of the buffer.
+	class InputStream: public protobuf::io::ZeroCopyInputStream {
+	public:
+		/// @param buffer The ring buffer to read from
+		/// @param offset Offset of the range from the start of the readable region
+		/// @param size Size of the range
+		InputStream(const RingBuffer &buffer, const std::size_t &offset, const std::size_t &size);
+
+		bool Next(const void ** data, int * size) override;
+
+		void BackUp(int count) override;
+
+		bool Skip(int count) override;
+
+		inline int64_t ByteCount() const override { return (int64_t)_position; }
+
+	private:
+		const RingBuffer &_buffer;
+
+		/// Start of the range, from the start of the readable region
+		std::size_t _offset;
+
+		/// Size of the range
+		std::size_t _size;
+
+		/// Number of bytes of the range already given out
+		std::size_t _position = 0;
+	};
+
+private:
+
+	/// The underlying memory, lent by the `BufferPool`
+	BufferPool::Buffer _storage;
+
+	/// Position of the first readable byte in the storage
+	std::size_t _begin = 0;
+
+	/// Number of readable bytes
+	std::size_t _size = 0;
+};
+
+} /* ::network */
+
+#endif /* RingBuffer_hpp */
@@ -0,0 +1,58 @@
+//
+//  SharedPayload.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-04-06.
+//
+
+#ifndef SharedPayload_hpp
+#define SharedPayload_hpp
+
+#include <memory>
+#include <string>
+
+#include <boost/asio/buffer.hpp>
+
+namespace network {
+
+/// Bytes formatted once and sent as-is by one or more sockets.
+///
+/// The payload must already be in the exchange format of the sockets it is
+/// sent on. It is immutable once queued, and is freed when the last socket
+/// holding it is done with it.
+struct SharedPayload {
+	/// The formatted bytes
+	std::string data;
+
+	/// Optional bytes sent as-is right after `data`. They are shared with the
+	/// producer of the payload and are never copied.
+	std::shared_ptr<const std::string> body;
+
+	/// Optional bytes sent after the body
+	std::string trailer;
+
+	/// Released along with the payload, once every socket is done with it.
+	/// Give it a custom deleter to be notified of the end of the emission.
+	std::shared_ptr<void> completion;
+
+	/// Gives the number of bytes sent for the payload
+	inline std::size_t size() const {
+		return data.size() + (body ? body->size() : 0) + trailer.size();
+	}
+
+	/// Appends the buffers holding the payload to the given buffer sequence
+	template<class BufferSequence>
+	inline void appendBuffers(BufferSequence &buffers) const {
+		buffers.push_back(boost::asio::buffer(data));
+
+		if(body)
+			buffers.push_back(boost::asio::buffer(*body));
+
+		if(!trailer.empty())
+			buffers.push_back(boost::asio::buffer(trailer));
+	}
+};
+
+} /* ::network */
+
+#endif /* SharedPayload_hpp */
@@ -19,11 +19,10 @@
 
 #include "../Engine.hpp"
 #include "BaseSocket.hpp"
+#include "JSONCodec.hpp"
 #include "Ping.hpp"
 #include "SocketDelegate.hpp"
 
-#define RECEPTION_BUFFER_SIZE 128000
-
 namespace asio = boost::asio;
 
 namespace network {
@@ -66,39 +65,28 @@ protected:
 
 	// MARK: - Reception
 
-	inline virtual protobuf::Message * decodeMessageFromBuffer(boost::array<char, RECEPTION_BUFFER_SIZE> & buffer, const std::size_t &bytes_transferred) override {
+	inline virtual protobuf::Message * decodeMessageFromBuffer(protobuf::io::ZeroCopyInputStream * stream) override {
 		// Decode the message using the proper format
-		MessageFormat * message = new MessageFormat();
+		MessageFormat * message = makeMessage();
 
-		message->ParseFromArray(buffer.data(), (int)bytes_transferred);
+		message->ParseFromZeroCopyStream(stream);
 
 		return message;
 	}
 
-	inline virtual protobuf::Message * decodeMessageFromBuffer(boost::asio::streambuf * buffer, const std::size_t &bytes_transferred) override {
-		MessageFormat * message = new MessageFormat();
-
-		boost::asio::streambuf::const_buffers_type bufs = buffer->data();
-		std::string messageText = std::string(boost::asio::buffers_begin(bufs),
-											  boost::asio::buffers_begin(bufs) + bytes_transferred);
+	inline virtual protobuf::Message * decodeMessageFromJSON(const char * text, const std::size_t &size) override {
+		MessageFormat * message = makeMessage();
 
-		protobuf::util::JsonStringToMessage(messageText, message);
+		JSONCodec::instance()->decode(text, size, message);
 
-		// Clear buffer
-		buffer->consume(bytes_transferred);
 		return message;
 	}
 
 	/// Called everytime a valid datagram is received
 	inline virtual void onReceive(protobuf::Message * message) override {
 
-		if(getFormat() == json) {
-			if(delegate)
-				return delegate->socketDidReceive(this, message);
-
-			delete message;
-			return;
-		}
+		if(getFormat() == json || getFormat() == ndjson)
+			return deliver(message);
 
 		messages::Datagram * datagram = (messages::Datagram *)message;
 
@@ -107,11 +95,7 @@ protected:
 		// Make sure the parcel is really for us. Tracker datagrams numbers are comprised between 0-100 (Common) and 100-200 (Tracker)
 		if(dType >= 10) {
 			// Propagate message to delegate
-			if(delegate)
-				return delegate->socketDidReceive(this, datagram);
-
-			delete datagram;
-			return;
+			return deliver(datagram);
 		}
 
 		// System message
@@ -120,16 +104,44 @@ protected:
 				close();
 				break;
 			case datagramType::ping:
-				onPing(datagram->mutable_data(), this);
+				onPing(datagram, this);
 				break;
 			case datagramType::pong:
-				onPong(datagram->mutable_data(), this);
+				onPong(datagram, this);
 				break;
 			default:
 				LOG_WARN("Received unrecognized Socket command " + std::to_string(dType));
 		}
 
-		delete datagram;
+		// Messages in the reception arena are released with it
+		if(datagram->GetArena() == nullptr)
+			delete datagram;
+	}
+
+private:
+
+	/// Gives a new message, allocated in the reception arena if the socket uses one
+	inline MessageFormat * makeMessage() {
+		if(getReceptionArena() != nullptr)
+			return protobuf::Arena::CreateMessage<MessageFormat>(getReceptionArena());
+
+		return new MessageFormat();
+	}
+
+	/// Gives the received message to the delegate. Messages allocated on the heap
+	/// are given to the delegate, or freed if there is none.
+	inline void deliver(protobuf::Message * message) {
+		if(message->GetArena() != nullptr) {
+			if(delegate)
+				delegate->socketDidReceiveTransient(this, *message);
+
+			return;
+		}
+
+		if(delegate)
+			return delegate->socketDidReceive(this, message);
+
+		delete message;
 	}
 };
 
@@ -23,15 +23,57 @@ public:
 	/// Called when the socket did connect to its remote
 	virtual void socketDidOpen(BaseSocket *) {}
 
+	/// Called when an asynchronous connection failed, timed out, or was
+	/// aborted by closing the socket. The socket can be connected again.
+	virtual void socketDidFailToConnect(BaseSocket *) {}
+
 	/// Called everytime the socket received a datagram from the
 	/// network. Some datagram with Socket-specific types, such as
 	/// 'close' might not be propagated to this method.
+	///
+	/// The delegate takes ownership of the message, and is responsible
+	/// for freeing it.
 	virtual void socketDidReceive(BaseSocket *, const google::protobuf::Message *) {}
 
+	/// Called in place of `socketDidReceive` when the socket decodes messages
+	/// in an arena (see `BaseSocket::setUsingArena`).
+	///
+	/// The message is owned by the socket, and is only valid until this
+	/// method returns. It has to be copied to be kept longer.
+	virtual void socketDidReceiveTransient(BaseSocket *, const google::protobuf::Message &) {}
+
 	/// Called everytime the socket finished sending a message asynchronously.
 	/// This can be used to free the memory used by the message
 	virtual void socketDidSendAsynchronously(BaseSocket *, const google::protobuf::Message *) {}
 
+	/// Called for every message given as a raw pointer that was queued but
+	/// will never be sent, for example because the socket closed or because a
+	/// newer message replaced it in a conflating queue.
+	/// This can be used to free the memory used by the message
+	virtual void socketDidDropMessage(BaseSocket *, const google::protobuf::Message *) {}
+
+	/// Called when the messages waiting to be sent reach the high watermark of
+	/// the socket queue. This can be used to slow down the emission until
+	/// `socketDidReachLowWatermark` is called.
+	virtual void socketDidReachHighWatermark(BaseSocket *) {}
+
+	/// Called when the messages waiting to be sent go back under the low
+	/// watermark of the socket queue, after reaching its high watermark
+	virtual void socketDidReachLowWatermark(BaseSocket *) {}
+
+	/// Called when the failure detector of the socket suspects the remote to
+	/// be gone, nothing having been received from it for unusually long.
+	/// See `BaseSocket::setFailureDetection`.
+	virtual void socketDidSuspectRemote(BaseSocket *) {}
+
+	/// Called when something is received from a suspected remote, before it
+	/// was considered gone
+	virtual void socketDidRecoverRemote(BaseSocket *) {}
+
+	/// Called when the failure detector of the socket considers the remote
+	/// gone. The socket closes right after if set to.
+	virtual void socketDidLoseRemote(BaseSocket *) {}
+
 	/// Called when the socket disconnects/closes
 	///
 	/// Once the socket is closed, a new one should be used to
@@ -8,6 +8,8 @@
 #ifndef SocketStatus_h
 #define SocketStatus_h
 
+#include <cstdint>
+
 namespace network {
 
 /// Defines status a `Socket` can have in its lifetime
@@ -21,13 +23,76 @@ enum SocketStatus {
 /// Defines available mechanisms for sending on a `Socket`
 enum EmissionType {
 	sync,
-	async
+	async,
+	/// Messages are sent asynchronously, grouped in batches. A batch is sent once
+	/// it is large enough, or after a short delay. See `BaseSocket::setBatching`
+	batched
+};
+
+/// Defines the priority lanes of the asynchronous emission of a `Socket`. Each
+/// lane has its own queue, and higher priority lanes are sent first.
+enum Lane: uint8_t {
+	/// Connection management messages, such as ping, pong and close. Always
+	/// sent first, and never subject to the queue limits
+	controlLane = 0,
+	highLane = 1,
+	/// The lane of messages sent without specifying one
+	normalLane = 2,
+	bulkLane = 3
+};
+
+/// Number of lanes of a socket
+constexpr unsigned int laneCount = 4;
+
+/// Defines how the lanes of a `Socket` share the emission
+enum LaneScheduling {
+	/// A lane is only sent once all the lanes with a higher priority are empty
+	strictPriority,
+	/// The control lane is sent first, the other lanes share the emission in
+	/// proportion to their weights, in bytes
+	weightedFair
+};
+
+/// Defines what a `Socket` does with a message sent while its queue is full
+enum OverflowPolicy {
+	/// Wait for the queue to make room for the message. Messages sent from
+	/// the network thread, which cannot wait, are queued anyway
+	block,
+	/// Drop the message being sent
+	dropNewest,
+	/// Drop the oldest queued messages to make room for the message
+	dropOldest,
+	/// Drop the message and close the connection
+	closeConnection
 };
 
 /// Definese available formats when sending and receiving on a `Socket`
 enum SocketFormat {
+	/// Raw protobuf messages, one message per reception. Kept for compatibility
+	/// with remotes that do not frame their messages.
 	protobuf,
-	json
+	/// JSON messages. Messages are sent followed by a new line, and received
+	/// up to an empty line.
+	json,
+	/// Protobuf messages prefixed by their size as a varint. Multiple messages
+	/// can be sent and received in a single network operation.
+	protobufFramed,
+	/// Newline-delimited JSON. Each message is a single line of JSON, sent and
+	/// received with the same delimiter.
+	ndjson,
+	/// Framed protobuf messages, grouped in frames compressed using the
+	/// `CompressionCodec` of the socket. Both sides must use this format.
+	compressed
+};
+
+/// Defines available codecs for the `compressed` format
+enum CompressionCodec: uint8_t {
+	/// No compression
+	uncompressed = 0,
+	/// LZ4, for the lowest latency
+	lz4 = 1,
+	/// Zstandard, for the best compression ratio
+	zstd = 2
 };
 
 } /* ::network */
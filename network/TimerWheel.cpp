@@ -0,0 +1,251 @@
+//
+//  TimerWheel.cpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#include <algorithm>
+
+#include "TimerWheel.hpp"
+#include "Engine.hpp"
+
+namespace network {
+
+/// Marks a timer taken out of the wheels to be run
+static constexpr uint32_t firing = UINT32_MAX - 1;
+
+TimerWheel::TimerWheel(asio::io_context &context):
+_ticker(context),
+_start(std::chrono::steady_clock::now()) {
+	std::fill(std::begin(_slots), std::end(_slots), none);
+}
+
+TimerWheel::TimerID TimerWheel::schedule(const unsigned int &delay, std::function<void()> callback) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// An empty wheel has nothing to catch up with
+	if(_count == 0)
+		_now = std::max(_now, currentTick());
+
+	uint32_t index = _freeTimers;
+
+	if(index == none) {
+		index = (uint32_t)_timers.size();
+		_timers.emplace_back();
+	} else {
+		_freeTimers = _timers[index].next;
+	}
+
+	Timer &timer = _timers[index];
+	timer.callback = std::move(callback);
+	timer.expiry = std::max(currentTick(), _now) + std::max(delay, 1u);
+
+	insert(index);
+	arm();
+
+	Engine::instance()->runContext();
+
+	return ((TimerID)timer.generation << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerID &timer) {
+	if(timer == 0)
+		return false;
+
+	const uint32_t index = (uint32_t)(timer & UINT32_MAX) - 1;
+	const uint32_t generation = (uint32_t)(timer >> 32);
+
+	timer = 0;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(index >= _timers.size() || _timers[index].generation != generation || _timers[index].slot == none)
+		return false;
+
+	// Timers about to run are only released
+	if(_timers[index].slot != firing)
+		unlink(index);
+
+	release(index);
+	return true;
+}
+
+uint64_t TimerWheel::currentTick() const {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start).count();
+}
+
+void TimerWheel::insert(const uint32_t &index) {
+	Timer &timer = _timers[index];
+	uint32_t slot;
+
+	if(timer.expiry <= _now) {
+		// Due in the tick being processed
+		slot = _now & slotMask;
+	} else if(timer.expiry - _now < slotCount) {
+		slot = timer.expiry & slotMask;
+	} else {
+		// Timers further than the coarse wheel are put in its last slot, and
+		// placed again once it is reached
+		const uint64_t blocks = std::min<uint64_t>((timer.expiry >> slotBits) - (_now >> slotBits), slotCount);
+		slot = slotCount + (((_now >> slotBits) + blocks) & slotMask);
+	}
+
+	timer.slot = slot;
+	timer.previous = none;
+	timer.next = _slots[slot];
+
+	if(timer.next != none)
+		_timers[timer.next].previous = index;
+
+	_slots[slot] = index;
+
+	++_count;
+
+	if(slot < slotCount)
+		++_fineCount;
+}
+
+void TimerWheel::unlink(const uint32_t &index) {
+	Timer &timer = _timers[index];
+
+	if(timer.previous != none)
+		_timers[timer.previous].next = timer.next;
+	else
+		_slots[timer.slot] = timer.next;
+
+	if(timer.next != none)
+		_timers[timer.next].previous = timer.previous;
+
+	--_count;
+
+	if(timer.slot < slotCount)
+		--_fineCount;
+
+	timer.slot = none;
+	timer.previous = none;
+	timer.next = none;
+}
+
+void TimerWheel::release(const uint32_t &index) {
+	Timer &timer = _timers[index];
+
+	timer.callback = nullptr;
+	timer.slot = none;
+	++timer.generation;
+
+	timer.next = _freeTimers;
+	_freeTimers = index;
+}
+
+void TimerWheel::tick() {
+	std::vector<std::pair<uint32_t, uint32_t>> due;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_wakeTick = 0;
+
+		const uint64_t target = currentTick();
+
+		while(_now < target) {
+			if(_count == 0) {
+				_now = target;
+				break;
+			}
+
+			// Nothing is due before the coarse wheel moves
+			if(_fineCount == 0) {
+				const uint64_t boundary = ((_now >> slotBits) + 1) << slotBits;
+
+				if(boundary > target) {
+					_now = target;
+					break;
+				}
+
+				_now = boundary - 1;
+			}
+
+			++_now;
+
+			// Move the coarse slot reached to the fine wheel
+			if((_now & slotMask) == 0) {
+				const uint32_t slot = slotCount + ((_now >> slotBits) & slotMask);
+				uint32_t index = _slots[slot];
+
+				while(index != none) {
+					const uint32_t next = _timers[index].next;
+
+					unlink(index);
+					insert(index);
+
+					index = next;
+				}
+			}
+
+			uint32_t index = _slots[_now & slotMask];
+
+			while(index != none) {
+				const uint32_t next = _timers[index].next;
+
+				unlink(index);
+				_timers[index].slot = firing;
+				due.emplace_back(index, _timers[index].generation);
+
+				index = next;
+			}
+		}
+
+		arm();
+	}
+
+	// Timers may be cancelled while the previous ones run
+	for(const std::pair<uint32_t, uint32_t> &timer: due) {
+		std::function<void()> callback;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if(_timers[timer.first].generation != timer.second || _timers[timer.first].slot != firing)
+				continue;
+
+			callback = std::move(_timers[timer.first].callback);
+			release(timer.first);
+		}
+
+		callback();
+	}
+}
+
+void TimerWheel::arm() {
+	if(_count == 0)
+		return;
+
+	// The next block of ticks, for the coarse wheel
+	uint64_t next = ((_now >> slotBits) + 1) << slotBits;
+
+	if(_fineCount > 0) {
+		for(uint64_t tick = _now + 1; tick < _now + slotCount; ++tick) {
+			if(_slots[tick & slotMask] != none) {
+				next = std::min(next, tick);
+				break;
+			}
+		}
+	}
+
+	// The ticker already wakes up in time
+	if(_wakeTick != 0 && _wakeTick <= next)
+		return;
+
+	_wakeTick = next;
+
+	_ticker.expires_at(_start + std::chrono::milliseconds(next));
+	_ticker.async_wait([&] (const boost::system::error_code &error) {
+		// Operation aborted is send if the ticker is set again
+		if(error != boost::asio::error::operation_aborted)
+			tick();
+	});
+}
+
+} /* ::network */
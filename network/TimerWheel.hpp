@@ -0,0 +1,139 @@
+//
+//  TimerWheel.hpp
+//  network
+//
+//  Created by Valentin Dufois on 2020-03-16.
+//  Copyright © 2020 Perihelion. All rights reserved.
+//
+
+#ifndef TimerWheel_hpp
+#define TimerWheel_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "network.hpp"
+
+namespace asio = boost::asio;
+
+namespace network {
+
+/// A hashed timer wheel, holding the timers of all the sockets, servers and
+/// advertisers on a single asio timer.
+///
+/// Timers are kept in two wheels. The fine wheel has one slot per tick, and
+/// holds the timers due in the next 256 ticks. The coarse wheel has one slot
+/// per 256 ticks, and holds the later ones. Its slots are moved to the fine
+/// wheel as time goes. Scheduling and cancelling a timer are constant time.
+///
+/// Callbacks are run on the thread of the engine context. Timers can be
+/// scheduled and cancelled from any thread.
+class TimerWheel {
+public:
+
+	/// Identifies a scheduled timer. Zero is never used.
+	using TimerID = uint64_t;
+
+	/// Creates a timer wheel running on the given context
+	/// @param context The context running the callbacks
+	TimerWheel(asio::io_context &context);
+
+	/// Schedules the given callback after the given delay
+	/// @param delay Delay in milliseconds
+	/// @param callback The function to call
+	/// @return The id of the timer, to cancel it
+	TimerID schedule(const unsigned int &delay, std::function<void()> callback);
+
+	/// Cancels the given timer. Does nothing if the timer already fired. Once
+	/// cancelled, the callback is not called.
+	/// @param timer A timer id. It is set to zero
+	/// @return True if the timer was cancelled
+	bool cancel(TimerID &timer);
+
+	/// Gives the number of timers scheduled
+	inline std::size_t getCount() const { return _count; }
+
+private:
+
+	static constexpr unsigned int slotBits = 8;
+
+	static constexpr unsigned int slotCount = 1 << slotBits;
+
+	static constexpr unsigned int slotMask = slotCount - 1;
+
+	/// Marks the end of a list of timers
+	static constexpr uint32_t none = UINT32_MAX;
+
+	/// A timer, linked in a slot of a wheel
+	struct Timer {
+		std::function<void()> callback;
+
+		/// The tick at which the timer is due
+		uint64_t expiry = 0;
+
+		/// Incremented every time the timer is reused, invalidating previous ids
+		uint32_t generation = 0;
+
+		/// The slot holding the timer, in `_slots`
+		uint32_t slot = none;
+
+		uint32_t previous = none;
+		uint32_t next = none;
+	};
+
+	/// Wakes the wheel at the next tick where timers may be due
+	asio::steady_timer _ticker;
+
+	std::mutex _mutex;
+
+	/// All the timers. Unused ones are linked in a free list
+	std::vector<Timer> _timers;
+
+	uint32_t _freeTimers = none;
+
+	/// Heads of the slots of the fine wheel, followed by the coarse wheel
+	uint32_t _slots[slotCount * 2];
+
+	std::size_t _count = 0;
+
+	/// Number of timers in the fine wheel
+	std::size_t _fineCount = 0;
+
+	/// Time of tick zero
+	const std::chrono::steady_clock::time_point _start;
+
+	/// The last tick processed
+	uint64_t _now = 0;
+
+	/// The tick the ticker is set to wake up at, zero if it is not set
+	uint64_t _wakeTick = 0;
+
+	/// Gives the tick matching the current time
+	uint64_t currentTick() const;
+
+	/// Puts the given timer in the slot matching its expiry
+	void insert(const uint32_t &index);
+
+	/// Removes the given timer from its slot
+	void unlink(const uint32_t &index);
+
+	/// Gives the given timer back to the free list
+	void release(const uint32_t &index);
+
+	/// Runs the timers due up to the current time, and sets the next wake up
+	void tick();
+
+	/// Sets the ticker to wake up at the next tick where timers may be due.
+	/// Must be called holding the mutex
+	void arm();
+};
+
+} /* ::network */
+
+#endif /* TimerWheel_hpp */
@@ -16,6 +16,35 @@ using NetworkPort = unsigned short int;
 // MARK: Advertiser
 constexpr unsigned short int advertiserRate = 1; // Advertise every X seconds
 
+// MARK: Socket
+constexpr unsigned int sendTimeout = 2000; // Delay in milliseconds after which a synchronous send fails
+constexpr unsigned int connectTimeout = 5000; // Delay in milliseconds after which an asynchronous connection attempt fails
+constexpr unsigned int asyncBatchSize = 1024; // Maximum number of messages sent in a single asynchronous write
+constexpr unsigned int batchMaxSize = 65536; // Size in bytes at which a batched socket sends its waiting messages
+constexpr unsigned int batchDeadline = 200; // Maximum delay in microseconds before a batched socket sends its waiting messages
+constexpr unsigned int queueMaxSize = 0; // Maximum size in bytes of the messages waiting to be sent by a socket, 0 for no limit
+constexpr unsigned int queueMaxCount = 0; // Maximum number of messages waiting to be sent by a socket, 0 for no limit
+constexpr unsigned int serverQueueMaxSize = 16777216; // Maximum size in bytes of the messages waiting to be sent to each client of a server
+constexpr float queueHighWatermark = 0.75; // Part of its limits above which the queue of a socket is considered filling up
+constexpr float queueLowWatermark = 0.25; // Part of its limits under which a filled up queue is considered drained
+constexpr unsigned int laneQuantum = 4096; // Size in bytes a lane can send per unit of weight on each turn, when lanes are weighted
+constexpr unsigned int maxFrameSize = 1048576; // Size in bytes of the largest frame a socket accepts from its remote
+constexpr unsigned int failureCheckInterval = 20; // Interval in milliseconds between two checks of the failure detector of a socket
+constexpr double failureSuspectPhi = 3; // Suspicion level at which the remote of a socket is suspected to be gone
+constexpr double failureDeadPhi = 8; // Suspicion level at which the remote of a socket is considered gone
+
+// MARK: Server
+constexpr unsigned int idleCheckRate = 4; // Number of times per idle timeout the connections of a server are checked
+
+// MARK: Client
+constexpr unsigned int reconnectDelay = 100; // Delay in milliseconds before a client first tries to reconnect
+constexpr unsigned int reconnectMaxDelay = 10000; // Maximum delay in milliseconds between two reconnection attempts
+constexpr float reconnectJitter = 0.5; // Part of the reconnection delay randomly taken off, spreading clients reconnecting together
+constexpr unsigned int replayMaxCount = 1024; // Maximum number of unsent messages a client keeps to send once reconnected
+
+// MARK: RPC
+constexpr unsigned int rpcDeadline = 5000; // Delay in milliseconds after which a remote call without response fails
+
 enum datagramType: unsigned int {
 	undefined	= 0,		//
 	ping		= 5,		// Ping command
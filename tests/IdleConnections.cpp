@@ -0,0 +1,112 @@
+//
+//  IdleConnections.cpp
+//  network tests
+//
+//  Created by Valentin Dufois on 2020-04-10.
+//
+//  Checks that a server closes and releases its idle connections: a client
+//  that stops reading while the server is writing to it, and a client that
+//  never sends anything. Best run with the address sanitizer, as releasing a
+//  connection with operations in flight is what is tested.
+//
+//  Not part of the library target. From the repository root, generate the
+//  messages with `protoc -I network/Messages --cpp_out=network/Messages
+//  network/Messages/network.proto`, then build with:
+//
+//    c++ -std=gnu++14 -g -fsanitize=address -I. -I<common> tests/IdleConnections.cpp $(find network -name '*.cpp' -o -name '*.cc') -lprotobuf -lzstd -llz4 -lpthread -o idle-connections
+//
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include "../network/Server.hpp"
+
+using namespace network;
+using tcp = asio::ip::tcp;
+
+constexpr NetworkPort port = 52480;
+
+/// Exposes the connections count of the server
+class TestServer: public Server<> {
+public:
+	TestServer(): Server<>(port) {}
+
+	using BaseServer::socketsCount;
+};
+
+/// Waits until the given condition is met
+/// @return False if the condition is still not met after the timeout
+static bool waitFor(const std::function<bool()> &condition, const unsigned int &timeout) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+	while(!condition()) {
+		if(std::chrono::steady_clock::now() > deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	return true;
+}
+
+/// Connects a raw client to the server, with a tiny reception window
+static void connectClient(tcp::socket &client) {
+	client.open(tcp::v4());
+	client.set_option(asio::socket_base::receive_buffer_size(4096));
+	client.connect(tcp::endpoint(asio::ip::address_v4::loopback(), port));
+}
+
+static bool check(const char * name, const bool &result) {
+	std::printf("%s: %s\n", name, result ? "ok" : "FAILED");
+	return result;
+}
+
+int main() {
+	asio::io_context context;
+	bool success = true;
+
+	TestServer server;
+	server.open();
+
+	// MARK: Write-idle
+
+	server.setIdleTimeouts(0, 200);
+
+	tcp::socket reader(context);
+	connectClient(reader);
+
+	success &= check("write-idle client accepted", waitFor([&] { return server.socketsCount() == 1; }, 1000));
+
+	// The client never reads, the server is left with a write in flight
+	messages::Datagram datagram;
+	datagram.set_type(10);
+	datagram.set_payload(std::string(1 << 20, 'x'));
+
+	for(int i = 0; i < 8; ++i)
+		server.sendToAll(&datagram);
+
+	success &= check("write-idle client reaped", waitFor([&] { return server.getWriteReapedCount() == 1 && server.socketsCount() == 0; }, 2000));
+
+	// Leave the aborted write handler, then the release, the time to run
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	// MARK: Read-idle
+
+	server.setIdleTimeouts(200, 0);
+
+	tcp::socket silent(context);
+	connectClient(silent);
+
+	success &= check("read-idle client accepted", waitFor([&] { return server.socketsCount() == 1; }, 1000));
+	success &= check("read-idle client reaped", waitFor([&] { return server.getReadReapedCount() == 1 && server.socketsCount() == 0; }, 2000));
+	success &= check("reaped counts", server.getReapedCount() == 2);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	return success ? 0 : 1;
+}